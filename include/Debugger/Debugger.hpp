@@ -22,6 +22,7 @@
 #ifndef XENDBG_DEBUGGER_HPP
 #define XENDBG_DEBUGGER_HPP
 
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <sys/mman.h>
@@ -35,6 +36,7 @@
 #include <Xen/Common.hpp>
 #include <Xen/Domain.hpp>
 
+#include "MaskedMemory.hpp"
 #include "StopReason.hpp"
 
 #define X86_INT3 0xCC
@@ -55,11 +57,10 @@ namespace xd::dbg {
     {};
   };
 
-  using MaskedMemory = std::unique_ptr<unsigned char>;
-
   class Debugger : public std::enable_shared_from_this<Debugger> {
   private:
-    using BreakpointMap = std::unordered_map<xen::Address, uint8_t>;
+    // Ordered, so that the breakpoints within a range can be found directly
+    using BreakpointMap = std::map<xen::Address, uint8_t>;
 
   public:
     using OnStopFn = std::function<void(StopReason)>;
@@ -77,7 +78,9 @@ namespace xd::dbg {
     virtual void single_step() = 0;
 
     void insert_breakpoint(xen::Address address);
-    BreakpointMap::iterator remove_breakpoint(xen::Address address);
+    void remove_breakpoint(xen::Address address);
+    void insert_breakpoints(const std::vector<xen::Address> &addresses);
+    void remove_breakpoints(const std::vector<xen::Address> &addresses);
 
     virtual void insert_watchpoint(xen::Address address, uint32_t bytes, WatchpointType type);
     virtual void remove_watchpoint(xen::Address address, uint32_t bytes, WatchpointType type);
@@ -99,6 +102,8 @@ namespace xd::dbg {
     BreakpointMap _breakpoints;
 
   private:
+    GuestMemory read_memory(xen::Address address, size_t length);
+
     xen::Domain &_domain;
 
     OnStopFn _on_stop;
@@ -0,0 +1,131 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_MASKEDMEMORY_HPP
+#define XENDBG_MASKEDMEMORY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <Xen/Domain.hpp>
+#include <Xen/XenForeignMemory.hpp>
+
+namespace xd::dbg {
+
+  /**
+   * Guest memory that was small enough to be copied out rather than mapped.
+   */
+  class CopiedMemory {
+  public:
+    static constexpr size_t CAPACITY = xen::Domain::GUEST_MEMIO_MAX_SIZE;
+
+    unsigned char *get() { return _data.data(); };
+    const unsigned char *get() const { return _data.data(); };
+
+  private:
+    std::array<unsigned char, CAPACITY> _data;
+  };
+
+  using GuestMemory = std::variant<
+    xen::XenForeignMemory::MappedMemory<unsigned char>, CopiedMemory>;
+
+  /**
+   * A read-only view of guest memory as it would look without breakpoints:
+   * the guest bytes, plus an overlay of the original bytes that the
+   * breakpoints within the range replaced. Nothing is copied until a
+   * consumer asks for it.
+   */
+  class MaskedMemory {
+  public:
+    // (offset, original byte), sorted by offset
+    using Overlay = std::vector<std::pair<size_t, unsigned char>>;
+
+    MaskedMemory(GuestMemory memory, size_t length, Overlay overlay)
+      : _memory(std::move(memory)), _length(length), _overlay(std::move(overlay))
+    {};
+
+    size_t size() const { return _length; };
+    const Overlay &get_overlay() const { return _overlay; };
+
+    unsigned char operator[](size_t offset) const {
+      const auto it = std::lower_bound(_overlay.begin(), _overlay.end(), offset,
+        [](const auto &entry, size_t offset) {
+          return entry.first < offset;
+        });
+      if (it != _overlay.end() && it->first == offset)
+        return it->second;
+      return data()[offset];
+    }
+
+    // Calls f(data, length) on successive chunks that together make up the
+    // masked contents, in order
+    template <typename F>
+    void for_each_chunk(F f) const {
+      const auto data = this->data();
+      size_t pos = 0;
+      for (const auto &[offset, byte] : _overlay) {
+        if (offset > pos)
+          f(data + pos, offset - pos);
+        f(&byte, 1);
+        pos = offset + 1;
+      }
+      if (pos < _length)
+        f(data + pos, _length - pos);
+    }
+
+    void copy(void *dest, size_t offset, size_t length) const {
+      auto out = (unsigned char*)dest;
+      memcpy(out, data() + offset, length);
+      for (const auto &[bp_offset, byte] : _overlay)
+        if (bp_offset >= offset && bp_offset < offset + length)
+          out[bp_offset - offset] = byte;
+    }
+
+    // Returns a pointer to the masked contents, copying them into buffer
+    // only if there is anything to mask
+    const unsigned char *flatten(std::vector<unsigned char> &buffer) const {
+      if (_overlay.empty())
+        return data();
+      buffer.resize(_length);
+      copy(buffer.data(), 0, _length);
+      return buffer.data();
+    }
+
+  private:
+    // Not kept as a member: moving a CopiedMemory moves its bytes
+    const unsigned char *data() const {
+      return std::visit([](const auto &memory) -> const unsigned char* {
+        return memory.get();
+      }, _memory);
+    }
+
+    GuestMemory _memory;
+    size_t _length;
+    Overlay _overlay;
+  };
+
+}
+
+#endif //XENDBG_MASKEDMEMORY_HPP
@@ -24,23 +24,20 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
 #include <uvw.hpp>
 
-#include "GDBPacketQueue.hpp"
+#include "GDBPacketCompressor.hpp"
+#include "GDBPacketScanner.hpp"
+#include "GDBPacketWriter.hpp"
 #include "GDBServer/GDBRequest/GDBRequest.hpp"
 #include "GDBServer/GDBResponse/GDBResponse.hpp"
 
 namespace xd::gdb {
 
-  class UnknownPacketTypeException : public std::runtime_error {
-  public:
-    explicit UnknownPacketTypeException(const std::string &data)
-        : std::runtime_error(data) {};
-  };
-
-  class GDBPacket;
-
   class GDBConnection : public std::enable_shared_from_this<GDBConnection> {
   public:
     using OnReceiveFn = std::function<void(GDBConnection&, const req::GDBRequest&)>;
@@ -52,6 +49,13 @@ namespace xd::gdb {
 
     void enable_error_strings() { _error_strings = true; };
     void disable_ack_mode() { _ack_mode = false; };
+    void enable_threads_in_stop_reply() { _threads_in_stop_reply = true; };
+    bool is_threads_in_stop_reply_enabled() const { return _threads_in_stop_reply; };
+    void enable_compression(GDBPacketCompressor::Type type,
+        std::optional<size_t> min_size)
+    {
+      _output_compressor.enable(type, min_size);
+    };
 
     void stop();
     void read(OnReceiveFn on_receive, OnCloseFn on_close, OnErrorFn on_error);
@@ -61,13 +65,24 @@ namespace xd::gdb {
 
   private:
     std::shared_ptr<uvw::TcpHandle> _tcp;
-    GDBPacketQueue _input_queue;
-    bool _ack_mode, _is_initializing, _error_strings;
+    GDBPacketScanner _input_scanner;
+    GDBPacketWriter _output_writer;
+    GDBPacketCompressor _output_compressor;
+    std::string _packet_type;
+    bool _ack_mode, _is_initializing, _error_strings, _threads_in_stop_reply;
     OnCloseFn _on_close;
     OnErrorFn _on_error;
     OnReceiveFn _on_receive;
 
-    static req::GDBRequest parse_packet(const GDBPacket &packet);
+    void write(std::string_view data);
+
+    // Sets error and returns nothing if the packet is malformed, or returns
+    // nothing with error left null if its type is unknown
+    static std::optional<req::GDBRequest> parse_packet(
+        std::string_view contents, const char *&error);
+
+    // The name of a packet's type, e.g. "qSupported" or "m"
+    static std::string_view get_packet_type(std::string_view contents);
   };
 
 }
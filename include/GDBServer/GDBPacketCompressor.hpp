@@ -0,0 +1,90 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_GDBPACKETCOMPRESSOR_HPP
+#define XENDBG_GDBPACKETCOMPRESSOR_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+#include "GDBPacketWriter.hpp"
+
+namespace xd::gdb {
+
+  /*
+   * Shrinks outgoing packets whose payload is at least the minimum size.
+   * Until LLDB negotiates a compression type with QEnableCompression, text
+   * payloads without a '*' get the standard RSP run-length encoding.
+   * Afterwards every packet is framed as LLDB expects, as $N<payload> or
+   * $C<payload size>:<compressed payload>.
+   */
+  class GDBPacketCompressor {
+  public:
+    enum class Type {
+      None,
+      ZlibDeflate,
+    };
+
+    GDBPacketCompressor();
+    ~GDBPacketCompressor();
+
+    GDBPacketCompressor(const GDBPacketCompressor &other) = delete;
+    GDBPacketCompressor &operator=(const GDBPacketCompressor &other) = delete;
+
+    void enable(Type type, std::optional<size_t> min_size);
+
+    // Returns either packet itself or a replacement for it, which remains
+    // valid until the next call. packet_type is only used for statistics.
+    std::string_view compress(std::string_view packet, bool has_binary,
+        std::string_view packet_type);
+
+    void log_stats() const;
+
+  private:
+    struct Stats {
+      size_t packets = 0;
+      size_t raw_bytes = 0;
+      size_t sent_bytes = 0;
+      std::chrono::nanoseconds time{0};
+    };
+
+    Type _type;
+    size_t _min_size;
+    z_stream _zstream;
+    std::vector<unsigned char> _deflated;
+    GDBPacketWriter _writer;
+    std::map<std::string, Stats, std::less<>> _stats;
+
+    std::string_view deflate_packet(std::string_view payload);
+    std::string_view uncompressed_packet(std::string_view payload);
+    std::string_view run_length_packet(std::string_view payload);
+  };
+
+}
+
+#endif //XENDBG_GDBPACKETCOMPRESSOR_HPP
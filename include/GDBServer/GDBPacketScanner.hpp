@@ -0,0 +1,81 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_GDBPACKETSCANNER_HPP
+#define XENDBG_GDBPACKETSCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace xd::gdb {
+
+  /*
+   * Incrementally splits the raw input stream into packets. Scanning resumes
+   * where the previous call stopped and checksums are summed as the payload
+   * goes by, so each input byte is looked at once.
+   *
+   * Packets are handed out as views into the internal buffer; they remain
+   * valid until the next call to feed(). A packet longer than the advertised
+   * maximum is dropped rather than buffered: it is reported once, with
+   * too_long set and no contents, and the rest of it is skipped.
+   */
+  class GDBPacketScanner {
+  public:
+    struct Packet {
+      std::string_view contents;
+      bool checksum_valid;
+      bool too_long;
+    };
+
+    // The PacketSize advertised in qSupported
+    static constexpr size_t MAX_PACKET_SIZE = 0x20000;
+
+    GDBPacketScanner();
+
+    void feed(const char *data, size_t length);
+    std::optional<Packet> next();
+
+  private:
+    enum class State {
+      Idle,
+      Body,
+      Discard,
+      ChecksumHigh,
+      ChecksumLow,
+    };
+
+    std::vector<char> _buffer;
+    size_t _begin, _scan, _end;
+
+    State _state;
+    size_t _packet_start, _packet_end;
+    uint8_t _sum, _checksum;
+    bool _checksum_malformed, _discarding;
+
+    void make_room(size_t length);
+  };
+
+}
+
+#endif //XENDBG_GDBPACKETSCANNER_HPP
@@ -19,34 +19,45 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
-#ifndef XENDBG_GDBPACKET_HPP
-#define XENDBG_GDBPACKET_HPP
+#ifndef XENDBG_GDBPACKETWRITER_HPP
+#define XENDBG_GDBPACKETWRITER_HPP
 
 #include <cstddef>
-#include <string>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
 namespace xd::gdb {
 
-  class GDBPacket {
+  /*
+   * Frames outgoing packets into a buffer that is reused from one packet to
+   * the next. The checksum is summed as the payload is written, so nothing
+   * is ever walked twice.
+   */
+  class GDBPacketWriter {
   public:
-    explicit GDBPacket(std::string contents);
-    GDBPacket(std::string contents, uint8_t checksum);
+    GDBPacketWriter();
 
-    const std::string &get_contents() const { return _contents; };
-    const uint8_t &get_checksum() const { return _checksum; };
+    void begin();
+    std::string_view end();
 
-    std::string to_string() const;
+    void write(char c);
+    void write(std::string_view s);
+    void write_hex(const void *data, size_t length);
+    void write_binary(const void *data, size_t length);
+    void write_run_length(std::string_view s);
 
-    bool is_checksum_valid() const;
-    bool starts_with(const std::string &s) const;
+    // Whether escaped binary data was written since begin()
+    bool has_binary() const { return _has_binary; };
 
   private:
-    std::string _contents;
+    std::vector<char> _buffer;
     uint8_t _checksum;
+    bool _has_binary;
 
-    uint8_t calculate_checksum() const;
+    char *grow(size_t length);
   };
 
 }
 
-#endif //XENDBG_GDBPACKET_HPP
+#endif //XENDBG_GDBPACKETWRITER_HPP
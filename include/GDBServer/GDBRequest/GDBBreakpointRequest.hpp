@@ -27,7 +27,7 @@
 #define DECLARE_BREAKPOINT_REQUEST(name, ch) \
   class name : public GDBRequestBase { \
   public: \
-    explicit name(const std::string &data) \
+    explicit name(std::string_view data) \
       : GDBRequestBase(data, ch) \
     { \
       _type = read_hex_number<uint8_t>(); \
@@ -30,7 +30,7 @@ namespace xd::gdb::req {
 
   class MemoryReadRequest : public GDBRequestBase {
   public:
-    explicit MemoryReadRequest(const std::string &data);
+    explicit MemoryReadRequest(std::string_view data);
 
     uint64_t get_address() const { return _address; };
     uint64_t get_length() const { return _length; };
@@ -42,7 +42,37 @@ namespace xd::gdb::req {
 
   class MemoryWriteRequest : public GDBRequestBase {
   public:
-    explicit MemoryWriteRequest(const std::string &data);
+    explicit MemoryWriteRequest(std::string_view data);
+
+    uint64_t get_address() const { return _address; };
+
+    uint64_t get_length() const { return _length; };
+
+    const std::vector<unsigned char> &get_data() const { return _data; };
+
+  private:
+    uint64_t _address;
+    uint64_t _length;
+    std::vector<unsigned char> _data;
+  };
+
+  // LLDB's 'x': like 'm', but answered with binary data
+  class MemoryReadBinaryRequest : public GDBRequestBase {
+  public:
+    explicit MemoryReadBinaryRequest(std::string_view data);
+
+    uint64_t get_address() const { return _address; };
+    uint64_t get_length() const { return _length; };
+
+  private:
+    uint64_t _address;
+    uint64_t _length;
+  };
+
+  // 'X': like 'M', but with the data sent as escaped binary
+  class MemoryWriteBinaryRequest : public GDBRequestBase {
+  public:
+    explicit MemoryWriteBinaryRequest(std::string_view data);
 
     uint64_t get_address() const { return _address; };
 
@@ -22,6 +22,8 @@
 #ifndef XENDBG_GDBQUERYREQUEST_HPP
 #define XENDBG_GDBQUERYREQUEST_HPP
 
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "GDBRequestBase.hpp"
@@ -44,14 +46,27 @@ namespace xd::gdb::req {
 
   DECLARE_SIMPLE_REQUEST(QueryThreadInfoContinuingRequest, "qsThreadInfo");
 
+  // LLDB's QEnableCompression:type:<type>;[minsize:<n>;]
+  class QueryEnableCompressionRequest : public GDBRequestBase {
+  public:
+    explicit QueryEnableCompressionRequest(std::string_view data);
+
+    const std::string &get_type() const { return _type; };
+    std::optional<size_t> get_min_size() const { return _min_size; };
+
+  private:
+    std::string _type;
+    std::optional<size_t> _min_size;
+  };
+
   class QueryWatchpointSupportInfo : public GDBRequestBase {
   public:
-    explicit QueryWatchpointSupportInfo(const std::string &data);
+    explicit QueryWatchpointSupportInfo(std::string_view data);
   };
 
   class QuerySupportedRequest : public GDBRequestBase {
   public:
-    explicit QuerySupportedRequest(const std::string &data);
+    explicit QuerySupportedRequest(std::string_view data);
 
     const std::vector<std::string> get_features() { return _features; };
 
@@ -61,7 +76,7 @@ namespace xd::gdb::req {
 
   class QueryRegisterInfoRequest : public GDBRequestBase {
   public:
-    explicit QueryRegisterInfoRequest(const std::string &data);
+    explicit QueryRegisterInfoRequest(std::string_view data);
 
     uint16_t get_register_id() const { return _register_id; };
 
@@ -69,9 +84,23 @@ namespace xd::gdb::req {
     uint16_t _register_id;
   };
 
+  class QueryFeaturesReadRequest : public GDBRequestBase {
+  public:
+    explicit QueryFeaturesReadRequest(std::string_view data);
+
+    const std::string &get_annex() const { return _annex; };
+    size_t get_offset() const { return _offset; };
+    size_t get_length() const { return _length; };
+
+  private:
+    std::string _annex;
+    size_t _offset;
+    size_t _length;
+  };
+
   class QueryMemoryRegionInfoRequest : public GDBRequestBase {
   public:
-    explicit QueryMemoryRegionInfoRequest(const std::string &data);
+    explicit QueryMemoryRegionInfoRequest(std::string_view data);
 
     uint64_t get_address() const { return _address; };
 
@@ -34,7 +34,7 @@ namespace xd::gdb::req {
 
   class GeneralRegistersBatchReadRequest : public GDBRequestBase {
   public:
-    explicit GeneralRegistersBatchReadRequest(const std::string &data);
+    explicit GeneralRegistersBatchReadRequest(std::string_view data);
 
     size_t get_thread_id() const { return _thread_id; };
 
@@ -44,7 +44,7 @@ namespace xd::gdb::req {
 
   class RegisterReadRequest : public GDBRequestBase {
   public:
-    explicit RegisterReadRequest(const std::string &data);
+    explicit RegisterReadRequest(std::string_view data);
 
     uint16_t get_register_id() const { return _register_id; };
     size_t get_thread_id() const { return _thread_id; };
@@ -56,38 +56,52 @@ namespace xd::gdb::req {
 
   class RegisterWriteRequest : public GDBRequestBase {
   public:
-    explicit RegisterWriteRequest(const std::string &data);
+    explicit RegisterWriteRequest(std::string_view data);
 
     uint16_t get_register_id() const { return _register_id; };
-    uint64_t get_value() const { return _value; };
+    // Still in wire format, as the register's width isn't known here
+    const std::string &get_value_hex() const { return _value_hex; };
     size_t get_thread_id() const { return _thread_id; };
 
   private:
     uint16_t _register_id;
-    uint64_t _value;
+    std::string _value_hex;
     size_t _thread_id;
   };
 
   class GeneralRegistersBatchWriteRequest : public GDBRequestBase {
+  public:
+    explicit GeneralRegistersBatchWriteRequest(std::string_view data);
+
+    // Still in wire format; decoded straight into the raw CPU context
+    const std::string &get_registers_hex() const { return _registers_hex; };
+    size_t get_thread_id() const { return _thread_id; };
+
+  private:
+    std::string _registers_hex;
+    size_t _thread_id;
+  };
+
+  class SaveRegisterStateRequest : public GDBRequestBase {
+  public:
+    explicit SaveRegisterStateRequest(std::string_view data);
+
+    size_t get_thread_id() const { return _thread_id; };
+
   private:
-    using Value = std::variant<uint64_t, uint32_t, uint16_t, uint8_t>;
-    using Values =  std::vector<std::pair<size_t, Value>>;
+    size_t _thread_id;
+  };
 
+  class RestoreRegisterStateRequest : public GDBRequestBase {
   public:
-    explicit GeneralRegistersBatchWriteRequest(const std::string &data);
+    explicit RestoreRegisterStateRequest(std::string_view data);
 
-    const Values& get_values() const { return _values; };
+    size_t get_save_id() const { return _save_id; };
+    size_t get_thread_id() const { return _thread_id; };
 
   private:
-    Values _values;
-
-    template <typename Metadata_t>
-    std::optional<typename Metadata_t::Register::Value> read_word(
-        const Metadata_t&)
-    {
-      using RegisterValue = typename Metadata_t::Register::Value;
-      return read_word_unsigned_opt<RegisterValue>();
-    }
+    size_t _save_id;
+    size_t _thread_id;
   };
 
 }
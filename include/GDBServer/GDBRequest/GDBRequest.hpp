@@ -50,7 +50,7 @@ namespace xd::gdb::req {
 
   class RestartRequest : public GDBRequestBase {
   public:
-    explicit RestartRequest(const std::string &data)
+    explicit RestartRequest(std::string_view data)
       : GDBRequestBase(data, 'R')
     {
       read_byte(); // Required, but ignored
@@ -60,7 +60,7 @@ namespace xd::gdb::req {
 
   class DetachRequest : public GDBRequestBase {
   public:
-    explicit DetachRequest(const std::string &data)
+    explicit DetachRequest(std::string_view data)
       : GDBRequestBase(data, 'D'), _pid(0)
     {
       if (has_more()) {
@@ -78,7 +78,7 @@ namespace xd::gdb::req {
 
   class SetThreadRequest : public GDBRequestBase {
   public:
-    explicit SetThreadRequest(const std::string &data)
+    explicit SetThreadRequest(std::string_view data)
       : GDBRequestBase(data, 'H')
     {
       if (check_char('c'))
@@ -109,6 +109,7 @@ namespace xd::gdb::req {
     QueryWatchpointSupportInfo,
     QuerySupportedRequest,
     QueryEnableErrorStrings,
+    QueryEnableCompressionRequest,
     QueryThreadSuffixSupportedRequest,
     QueryListThreadsInStopReplySupportedRequest,
     QueryCurrentThreadIDRequest,
@@ -117,6 +118,7 @@ namespace xd::gdb::req {
     QueryHostInfoRequest,
     QueryProcessInfoRequest,
     QueryRegisterInfoRequest,
+    QueryFeaturesReadRequest,
     QueryMemoryRegionInfoRequest,
     StopReasonRequest,
     KillRequest,
@@ -125,8 +127,12 @@ namespace xd::gdb::req {
     RegisterWriteRequest,
     GeneralRegistersBatchReadRequest,
     GeneralRegistersBatchWriteRequest,
+    SaveRegisterStateRequest,
+    RestoreRegisterStateRequest,
     MemoryReadRequest,
     MemoryWriteRequest,
+    MemoryReadBinaryRequest,
+    MemoryWriteBinaryRequest,
     ContinueRequest,
     ContinueSignalRequest,
     StepRequest,
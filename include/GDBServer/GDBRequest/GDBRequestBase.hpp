@@ -22,15 +22,18 @@
 #ifndef XENDBG_GDBREQUESTPACKETBASE_HPP
 #define XENDBG_GDBREQUESTPACKETBASE_HPP
 
-#include <iostream>
+#include <algorithm>
+#include <cstdint>
 #include <optional>
-#include <stdexcept>
 #include <string>
+#include <string_view>
+
+#include <Util/hex.hpp>
 
 #define DECLARE_SIMPLE_REQUEST(name, ch) \
   class name : public GDBRequestBase { \
   public: \
-    explicit name(const std::string &data) \
+    explicit name(std::string_view data) \
       : GDBRequestBase(data, ch) \
     { \
       expect_end(); \
@@ -39,26 +42,36 @@
 
 namespace xd::gdb::req {
 
-  class RequestPacketParseException : public std::runtime_error {
-  public:
-    RequestPacketParseException(const std::string &msg)
-        : std::runtime_error(msg) {};
-  };
-
+  /*
+   * Parsing never throws: the first failure is recorded and the rest of the
+   * input is discarded, so later reads fail too and the constructor falls
+   * through. Check is_valid() once the request has been built. The data is
+   * only referenced while parsing, so it need not outlive the constructor.
+   */
   class GDBRequestBase {
   public:
-    GDBRequestBase(const std::string &data, char header)
-        : _data(data), _it(_data.begin())
+    GDBRequestBase(std::string_view data, char header)
+        : _data(data), _it(_data.begin()), _error(nullptr)
     {
       expect_char(header);
     };
 
-    GDBRequestBase(const std::string &data, const std::string &header)
-        : _data(data), _it(_data.begin())
+    GDBRequestBase(std::string_view data, std::string_view header)
+        : _data(data), _it(_data.begin()), _error(nullptr)
     {
       expect_string(header);
     };
 
+    bool is_valid() const { return !_error; };
+    const char *get_error() const { return _error; };
+
+  protected:
+    void fail(const char *error) {
+      if (!_error)
+        _error = error;
+      _it = _data.end();
+    };
+
     size_t get_num_remaining() {
       return _data.end() - _it;
     };
@@ -68,23 +81,19 @@ namespace xd::gdb::req {
     }
 
     void assert_char_not(char ch) {
-      expect_more();
       if (peek() == ch)
-        throw RequestPacketParseException(
-            std::string("assert_char_not(") + ch + ") failed");
+        fail("assert_char_not failed");
     };
 
     bool check_char(char ch) {
-      bool found = (peek() == ch);
+      bool found = has_more() && (*_it == ch);
       if (found)
-        get_char();
+        ++_it;
       return found;
     };
 
-    bool check_string(const std::string &s) {
-      bool found = ((size_t)(_data.end() - _it) >= s.size()) &&
-                   std::equal(s.begin(), s.end(), _it, _data.end());
-
+    bool check_string(std::string_view s) {
+      bool found = (_data.substr(_it - _data.begin(), s.size()) == s);
       if (found)
         _it += s.size();
       return found;
@@ -92,76 +101,82 @@ namespace xd::gdb::req {
 
     void expect_char(char ch) {
       if (get_char() != ch)
-        throw RequestPacketParseException(
-            std::string("expect_char(") + ch + ") failed");
+        fail("expect_char failed");
     };
 
     void skip_space() {
-      while (peek() == ' ')
-        get_char();
+      while (check_char(' '));
     };
 
-    void expect_string(const std::string& s) {
-      for (const auto c : s) {
-        expect_char(c);
-      }
+    void expect_string(std::string_view s) {
+      if (!check_string(s))
+        fail("expect_string failed");
     }
 
-    void expect_more(size_t n = 1) {
-      if (!has_more(n))
-        throw RequestPacketParseException(
-            std::string("expect_more(") + std::to_string(n) + ") failed");
+    bool expect_more(size_t n = 1) {
+      if (has_more(n))
+        return true;
+      fail("expect_more failed");
+      return false;
     }
 
     void expect_end() {
       if (has_more())
-        throw RequestPacketParseException("expect_end() failed");
+        fail("expect_end failed");
     }
 
     char peek() {
-      expect_more();
-      return *_it;
+      return expect_more() ? *_it : '\0';
     };
 
     char get_char() {
-      expect_more();
-      return *_it++;
+      return expect_more() ? *_it++ : '\0';
     };
 
     uint8_t read_byte() {
-      const auto from_hex = [](const auto c) {
-        if (c >= '0' && c <= '9')
-          return c - '0';
+      const auto c1 = util::hex::digit_value(get_char());
+      const auto c2 = util::hex::digit_value(get_char());
 
-        auto cl = std::tolower(c);
-        if (cl >= 'a' && cl <= 'f')
-          return 0xa + (cl - 'a');
+      if (c1 < 0 || c2 < 0) {
+        fail("read_byte failed on invalid hex char");
+        return 0;
+      }
 
-        throw RequestPacketParseException(
-            std::string("read_byte failed on invalid hex char '")
-            + std::to_string((unsigned)cl) + "'");
-      };
+      return (c1 << 4) + c2;
+    };
 
-      uint8_t c1 = from_hex(get_char());
-      uint8_t c2 = from_hex(get_char());
+    // Decodes length bytes of hex into out in one pass
+    void read_hex_bytes(void *out, size_t length) {
+      if (!expect_more(2*length))
+        return;
+      if (!util::hex::decode(&*_it, length, out))
+        fail("read_hex_bytes failed on invalid hex char");
+      else
+        _it += 2*length;
+    };
 
-      return (c1 << 4) + c2;
+    // Reads length bytes of binary data, undoing the '}' escaping of '#',
+    // '$', '}' and '*'
+    void read_escaped_bytes(unsigned char *out, size_t length) {
+      for (size_t i = 0; i < length && is_valid(); ++i) {
+        const auto c = get_char();
+        out[i] = (c == '}') ? (get_char() ^ 0x20) : c;
+      }
     };
 
     template <typename Value_t>
     Value_t read_hex_number() {
-      size_t end;
-      const std::string num_str(_it, _data.end());
-      Value_t num = std::stoull(num_str, &end, 2*sizeof(uint64_t));
-
-      _it += end;
+      return read_number<Value_t, 16>();
+    };
 
-      return num;
+    template <typename Value_t>
+    Value_t read_dec_number() {
+      return read_number<Value_t, 10>();
     };
 
     template <typename Value_t>
     Value_t read_hex_number_respecting_endianness() {
-      Value_t value;
+      Value_t value{};
       uint8_t *value_ptr = (uint8_t*)&value;
       size_t remaining = 2*sizeof(Value_t);
 
@@ -171,57 +186,80 @@ namespace xd::gdb::req {
       }
 
       if (remaining)
-        throw RequestPacketParseException("Incomplete hex number");
+        fail("Incomplete hex number");
 
       return value;
     };
 
     std::string read_until_end() {
-      std::string s;
-      while (has_more()) {
-        s.push_back(get_char());
-      }
-      if (has_more())
-        get_char();
+      std::string s(_it, _data.end());
+      _it = _data.end();
       return s;
     }
 
     std::string read_until_char_or_end(char ch) {
-      std::string s;
-      while (has_more() && peek() != ch) {
-        s.push_back(get_char());
-      }
+      const auto rest = _data.substr(_it - _data.begin());
+      const auto s = rest.substr(0, rest.find(ch));
+      _it += s.size();
       if (has_more())
         get_char();
-      return s;
+      return std::string(s);
     }
 
     template <typename Word_t>
     std::optional<Word_t> read_word_unsigned_opt() {
       static constexpr auto SIZE = 2*sizeof(Word_t);
-      static const auto NOT_SPECIFIED = std::string(SIZE, 'x');
 
-      expect_more(SIZE);
-      const std::string s(_it, _it + SIZE);
+      if (!expect_more(SIZE))
+        return std::nullopt;
 
-      if (s == NOT_SPECIFIED)
+      if (std::all_of(_it, _it + SIZE, [](char c) { return c == 'x'; })) {
+        _it += SIZE;
         return std::nullopt;
+      }
 
-      size_t end;
-      Word_t num = std::stoull(s, &end, 16);
-      if (end != SIZE)
-        throw RequestPacketParseException("Incomplete hex number");
+      uint64_t num = 0;
+      for (size_t i = 0; i < SIZE; ++i) {
+        const auto digit = util::hex::digit_value(*_it++);
+        if (digit < 0) {
+          fail("Incomplete hex number");
+          return std::nullopt;
+        }
+        num = (num << 4) | digit;
+      }
 
-      _it += SIZE;
-      return num;
+      return (Word_t)num;
     }
 
   private:
-    const std::string _data;
-    std::string::const_iterator _it;
+    std::string_view _data;
+    std::string_view::const_iterator _it;
+    const char *_error;
+
+    template <typename Value_t, unsigned Base_v>
+    Value_t read_number() {
+      uint64_t num = 0;
+      size_t digits = 0;
+      while (has_more()) {
+        const auto digit = util::hex::digit_value(*_it);
+        if (digit < 0 || (unsigned)digit >= Base_v)
+          break;
+        if (num > (UINT64_MAX - digit) / Base_v) {
+          fail("Number out of range");
+          return 0;
+        }
+        num = num * Base_v + digit;
+        ++_it;
+        ++digits;
+      }
+
+      if (!digits)
+        fail("Expected a number");
+
+      return (Value_t)num;
+    };
   };
 
 }
 
 #endif //XENDBG_GDBREQUESTPACKETBASE_HPP
-
@@ -28,7 +28,7 @@
   DECLARE_SIMPLE_REQUEST(name1, ch1); \
   class name2 : public GDBRequestBase { \
   public: \
-    explicit name2(const std::string &data) \
+    explicit name2(std::string_view data) \
       : GDBRequestBase(data, ch2), _signal(0) \
     { \
       _signal = read_byte(); \
@@ -83,6 +83,16 @@ namespace xd::gdb {
     GDBConnection &_connection;
 
     std::vector<size_t> get_thread_ids() const;
+    std::vector<uint64_t> get_thread_pcs() const;
+
+    // The VCPU a request with an optional ";thread:" suffix is about; without
+    // one, that's the VCPU last selected with Hg
+    xen::VCPU_ID get_vcpu_id(size_t thread_id) const;
+
+    // Calls f with a description of the registers GDB clients see for the
+    // domain's word size
+    template <typename F>
+    void visit_target_registers(F f) const;
 
   public:
     // Default to a "not supported" response
@@ -22,8 +22,10 @@
 #ifndef XENDBG_GDBMEMORYRESPONSE_HPP
 #define XENDBG_GDBMEMORYRESPONSE_HPP
 
-#include <sstream>
-#include <vector>
+#include <optional>
+#include <string>
+
+#include <Debugger/MaskedMemory.hpp>
 
 #include "GDBResponseBase.hpp"
 
@@ -31,13 +33,28 @@ namespace xd::gdb::rsp {
 
   class MemoryReadResponse : public GDBResponse {
   public:
-    explicit MemoryReadResponse(unsigned char * data, size_t length)
-      : _data(data, data + length) {};
+    explicit MemoryReadResponse(dbg::MaskedMemory data)
+      : _data(std::move(data)) {};
+
+    std::string to_string() const override;
+    void write(GDBPacketWriter &writer) const override;
+
+  private:
+    dbg::MaskedMemory _data;
+  };
+
+  // Answers 'x' with 'b' and then the escaped binary data, if any
+  class MemoryReadBinaryResponse : public GDBResponse {
+  public:
+    MemoryReadBinaryResponse() = default;
+    explicit MemoryReadBinaryResponse(dbg::MaskedMemory data)
+      : _data(std::move(data)) {};
 
     std::string to_string() const override;
+    void write(GDBPacketWriter &writer) const override;
 
   private:
-    std::vector<unsigned char> _data;
+    std::optional<dbg::MaskedMemory> _data;
   };
 
 }
@@ -153,13 +153,20 @@ namespace xd::gdb::rsp {
     std::string _error;
   };
 
+  // A register with value_regs is a composite of those registers, in order,
+  // and has no offset of its own
   class QueryRegisterInfoResponse : public GDBResponse {
   public:
     QueryRegisterInfoResponse(
         std::string name, size_t width, size_t offset,
-          size_t gcc_register_id)
+          size_t gcc_register_id,
+          std::string set = "General Purpose Registers",
+          std::string encoding = "uint", std::string format = "hex",
+          std::vector<size_t> value_regs = {})
       : _name(std::move(name)), _width(width), _offset(offset),
-        _gcc_register_id(gcc_register_id)
+        _gcc_register_id(gcc_register_id), _set(std::move(set)),
+        _encoding(std::move(encoding)), _format(std::move(format)),
+        _value_regs(std::move(value_regs))
     {};
 
     std::string to_string() const override;
@@ -169,6 +176,25 @@ namespace xd::gdb::rsp {
     size_t _width;
     size_t _offset;
     size_t _gcc_register_id;
+    std::string _set;
+    std::string _encoding;
+    std::string _format;
+    std::vector<size_t> _value_regs;
+  };
+
+  // One chunk of a qXfer object; 'l' marks the last. The chunk is sent as
+  // escaped binary data.
+  class QueryFeaturesReadResponse : public GDBResponse {
+  public:
+    QueryFeaturesReadResponse(std::string data, bool is_last)
+      : _data(std::move(data)), _is_last(is_last) {};
+
+    std::string to_string() const override;
+    void write(GDBPacketWriter &writer) const override;
+
+  private:
+    std::string _data;
+    bool _is_last;
   };
 
 }
@@ -30,32 +30,39 @@
 
 namespace xd::gdb::rsp {
 
+  // Takes a register already hex-encoded by the domain's register codec
   class RegisterReadResponse : public GDBResponse {
   public:
-    explicit RegisterReadResponse(uint64_t value, int width = sizeof(uint64_t))
-      : _value(value), _width(width) {};
+    explicit RegisterReadResponse(std::string register_hex)
+      : _register_hex(std::move(register_hex)) {};
 
-    std::string to_string() const override;
+    std::string to_string() const override { return _register_hex; };
 
   private:
-    uint64_t _value;
-    int _width;
+    std::string _register_hex;
   };
 
+  // Takes registers already hex-encoded by the domain's register codec
   class GeneralRegistersBatchReadResponse : public GDBResponse {
   public:
-    explicit GeneralRegistersBatchReadResponse(xd::reg::RegistersX86Any registers)
-      : _registers(std::move(registers)) {}
+    explicit GeneralRegistersBatchReadResponse(std::string registers_hex)
+      : _registers_hex(std::move(registers_hex)) {}
 
-    std::string to_string() const override;
+    std::string to_string() const override { return _registers_hex; };
 
-    template <typename Reg_t>
-    static void write_register(std::stringstream &ss, const Reg_t&reg) {
-      ss << std::setw(2*sizeof(typename Reg_t::Value)) << reg;
-    }
+  private:
+    std::string _registers_hex;
+  };
+
+  class SaveRegisterStateResponse : public GDBResponse {
+  public:
+    explicit SaveRegisterStateResponse(size_t save_id)
+      : _save_id(save_id) {};
+
+    std::string to_string() const override { return std::to_string(_save_id); };
 
   private:
-    xd::reg::RegistersX86Any _registers;
+    size_t _save_id;
   };
 
 }
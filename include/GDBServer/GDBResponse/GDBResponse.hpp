@@ -66,15 +66,16 @@ namespace xd::gdb::rsp {
 
   class StopReasonSignalResponse : public GDBResponse {
   public:
-    StopReasonSignalResponse(uint8_t signal, size_t thread_id, std::vector<size_t> thread_ids)
+    StopReasonSignalResponse(uint8_t signal, size_t thread_id, std::vector<size_t> thread_ids,
+        std::vector<uint64_t> thread_pcs)
       : _signal(signal), _thread_id(thread_id), _thread_ids(std::move(thread_ids)),
-        _stop_reason_key(""), _stop_reason_value("")
+        _thread_pcs(std::move(thread_pcs)), _stop_reason_key(""), _stop_reason_value("")
     {};
 
     StopReasonSignalResponse(uint8_t signal, size_t thread_id, std::vector<size_t> thread_ids,
-        std::string stop_reason_key, std::string stop_reason_value)
+        std::vector<uint64_t> thread_pcs, std::string stop_reason_key, std::string stop_reason_value)
       : _signal(signal), _thread_id(thread_id), _thread_ids(std::move(thread_ids)),
-        _stop_reason_key(std::move(stop_reason_key)),
+        _thread_pcs(std::move(thread_pcs)), _stop_reason_key(std::move(stop_reason_key)),
         _stop_reason_value(std::move(stop_reason_value))
     {};
 
@@ -84,6 +85,7 @@ namespace xd::gdb::rsp {
     uint8_t _signal;
     size_t _thread_id;
     std::vector<size_t> _thread_ids;
+    std::vector<uint64_t> _thread_pcs;
     std::string _stop_reason_key, _stop_reason_value;
   };
 
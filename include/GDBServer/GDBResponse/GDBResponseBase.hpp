@@ -26,6 +26,8 @@
 #include <sstream>
 #include <string>
 
+#include <GDBServer/GDBPacketWriter.hpp>
+
 namespace xd::gdb::rsp {
 
   namespace {
@@ -72,6 +74,12 @@ namespace xd::gdb::rsp {
   public:
     virtual ~GDBResponse() = default;
     virtual std::string to_string() const = 0;
+
+    // Responses with bulky payloads override this to encode straight into
+    // the outgoing packet rather than building a string first
+    virtual void write(GDBPacketWriter &writer) const {
+      writer.write(to_string());
+    };
   };
 
 }
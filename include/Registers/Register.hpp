@@ -22,14 +22,23 @@
 #ifndef XENDBG_REGISTER_HPP
 #define XENDBG_REGISTER_HPP
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
 
 namespace xd::reg {
 
+  // Value type of registers wider than a word, e.g. x87 and vector registers
+  template <size_t width>
+  using RegisterBytes = std::array<uint8_t, width>;
+
+  // Only word-sized registers have sub-registers
   template <typename Value_t, size_t width>
-  class _Register_impl;
+  class _Register_impl {
+  public:
+    _Register_impl(Value_t &) {};
+  };
 
   template <typename Value_t>
   class _Register_impl<Value_t, 2> {
@@ -115,7 +124,7 @@ namespace xd::reg {
     {
     };
 
-    void clear() { _value = 0; };
+    void clear() { _value = Value_t{}; };
 
     Register &operator=(const Register &other) {
       _value = (Value_t)other;
@@ -152,16 +161,20 @@ namespace xd::reg {
 
 }
 
-#define DECLARE_REGISTER_ALTNAME(_name, _alt_name, _type, _gcc_id) \
+#define _DECLARE_REGISTER(_name, _alt_name, _type, _gcc_id) \
   struct _name : public xd::reg::Register<_type> { \
     _name() : xd::reg::Register<_type>() {}; \
     _name(_type value) : xd::reg::Register<_type>(value) {}; \
     static constexpr auto name = #_name; \
-    static constexpr auto alt_name = #_alt_name; \
+    static constexpr const char *alt_name = _alt_name; \
     static constexpr size_t gcc_id = _gcc_id; \
 }
 
+// The alternate name is the one GDB knows the register by, where it differs
+#define DECLARE_REGISTER_ALTNAME(_name, _alt_name, _type, _gcc_id) \
+  _DECLARE_REGISTER(_name, #_alt_name, _type, _gcc_id)
+
 #define DECLARE_REGISTER(_name, _type, _gcc_id) \
-  DECLARE_REGISTER_ALTNAME(_name, nullptr, _type, _gcc_id)
+  _DECLARE_REGISTER(_name, nullptr, _type, _gcc_id)
 
 #endif //XENDBG_REGISTER_HPP
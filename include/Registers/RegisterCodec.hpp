@@ -0,0 +1,160 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_REGISTERCODEC_HPP
+#define XENDBG_REGISTERCODEC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <Util/hex.hpp>
+
+#include "RegisterContext.hpp"
+
+namespace xd::reg {
+
+  // Where a register lives among the raw (e.g. Xen) CPU context structs a
+  // codec reads from: which of them, and where in it. A size of zero means
+  // there is no such field. Registers not stored as their own bytes give
+  // converters, which are handed the start of the field.
+  struct RawField {
+    size_t offset;
+    size_t size;
+    size_t source = 0;
+    void (*read)(const uint8_t *raw, uint8_t *bytes) = nullptr;
+    void (*write)(uint8_t *raw, const uint8_t *bytes) = nullptr;
+  };
+
+  enum class DecodeResult {
+    OK,
+    Malformed,
+    Unavailable, // A value was given for a register that has no field
+  };
+
+  template <typename Context_t>
+  class RegisterCodec;
+
+  /**
+   * Converts registers directly between raw CPU context structs and the
+   * hex encoding of GDB's 'g'/'G' packets, i.e. each register of the
+   * context in order, as little-endian bytes of the register's width. The
+   * layout tells the codec where each register is found in the raw structs,
+   * so no intermediate RegisterContext is ever built.
+   */
+  template <size_t _id, size_t _base, typename... Registers_t>
+  class RegisterCodec<_RegisterContext<_id, _base, Registers_t...>> {
+  public:
+    static constexpr size_t count = sizeof...(Registers_t);
+    static constexpr size_t size = (sizeof(typename Registers_t::Value) + ... + 0);
+    static constexpr size_t hex_size = 2*size;
+
+    using Layout = std::array<RawField, count>;
+
+    // FieldOf_t<Reg_t>::field gives the RawField of each register
+    template <template <typename> class FieldOf_t>
+    static constexpr Layout make_layout() {
+      return Layout{ FieldOf_t<Registers_t>::field... };
+    }
+
+    // Writes exactly hex_size chars to out. Registers without a field are
+    // given as all 'x', i.e. unavailable.
+    static void encode(const void *const *sources, const Layout &layout, char *out) {
+      for (size_t i = 0; i < count; ++i) {
+        if (!layout[i].size) {
+          std::fill(out, out + 2*widths[i], 'x');
+          out += 2*widths[i];
+          continue;
+        }
+
+        uint8_t bytes[max_width] = {};
+        read_field(sources, layout[i], bytes, widths[i]);
+
+        util::hex::encode(bytes, widths[i], out);
+        out += 2*widths[i];
+      }
+    }
+
+    // Reads exactly hex_size chars from in. Registers given as all 'x' are
+    // left as they are. Registers without a field may only be given as zero,
+    // which is what GDB sends back in 'G' for registers it was told are
+    // unavailable. On failure the sources may have been partially updated.
+    static DecodeResult decode(const char *in, const Layout &layout, void *const *sources) {
+      for (size_t i = 0; i < count; ++i) {
+        const auto width = widths[i];
+        if (*in == 'x') {
+          in += 2*width;
+          continue;
+        }
+
+        uint8_t bytes[max_width];
+        if (!util::hex::decode(in, width, bytes))
+          return DecodeResult::Malformed;
+        in += 2*width;
+
+        if (!layout[i].size) {
+          if (std::any_of(bytes, bytes + width, [](auto b) { return b != 0; }))
+            return DecodeResult::Unavailable;
+          continue;
+        }
+
+        write_field(sources, layout[i], bytes, width);
+      }
+      return DecodeResult::OK;
+    }
+
+  private:
+    static constexpr std::array<size_t, count> widths = {
+      sizeof(typename Registers_t::Value)...
+    };
+    static constexpr size_t max_width = std::max({
+      sizeof(typename Registers_t::Value)...
+    });
+
+    static void read_field(const void *const *sources, const RawField &field,
+        uint8_t *bytes, size_t width)
+    {
+      const auto src = (const uint8_t*)sources[field.source] + field.offset;
+      if (field.read)
+        field.read(src, bytes);
+      else
+        memcpy(bytes, src, std::min(width, field.size));
+    }
+
+    // Narrower registers are zero-extended into wider fields
+    static void write_field(void *const *sources, const RawField &field,
+        const uint8_t *bytes, size_t width)
+    {
+      const auto dest = (uint8_t*)sources[field.source] + field.offset;
+      if (field.write) {
+        field.write(dest, bytes);
+        return;
+      }
+      memset(dest, 0, field.size);
+      memcpy(dest, bytes, std::min(width, field.size));
+    }
+  };
+
+}
+
+#endif //XENDBG_REGISTERCODEC_HPP
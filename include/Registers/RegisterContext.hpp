@@ -22,8 +22,12 @@
 #ifndef XENDBG_REGISTER_CONTEXT_HPP
 #define XENDBG_REGISTER_CONTEXT_HPP
 
+#include <array>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <utility>
 
 namespace xd::reg {
   namespace {
@@ -119,6 +123,38 @@ namespace xd::reg {
     };
   }
 
+  namespace {
+    template <typename Context_t, size_t index>
+    struct _nth_level_impl {
+      using Level = typename _nth_level_impl<typename Context_t::Next, index-1>::Level;
+    };
+
+    template <typename Context_t>
+    struct _nth_level_impl<Context_t, 0> {
+      using Level = Context_t;
+    };
+
+    constexpr uint32_t _hash_name(std::string_view name, uint32_t seed) {
+      uint32_t hash = 2166136261u ^ seed;
+      for (const auto c : name) {
+        hash ^= (uint8_t)c;
+        hash *= 16777619u;
+      }
+      // FNV's low bits are weak, and only the low bits index the table
+      hash ^= hash >> 16;
+      hash *= 0x7feb352du;
+      hash ^= hash >> 15;
+      return hash;
+    }
+
+    constexpr size_t _next_pow2(size_t n) {
+      size_t p = 1;
+      while (p < n)
+        p <<= 1;
+      return p;
+    }
+  }
+
   template <size_t _id, size_t _base, typename... Registers_t>
   class _RegisterContext;
 
@@ -146,6 +182,7 @@ namespace xd::reg {
     }
 
     static constexpr size_t size = 0;
+    static constexpr size_t count = 0;
 
     template <typename Reg_t>
     static constexpr size_t offset_of =
@@ -186,6 +223,8 @@ namespace xd::reg {
     friend struct _get_impl;
     template <typename Context_t, typename Reg_t, bool matches>
     friend struct __get_impl;
+    template <typename Context_t, size_t index>
+    friend struct _nth_level_impl;
 
     using This = _RegisterContext<_id, _base, Register_t, Registers_t...>;
     using Next = _RegisterContext<
@@ -208,6 +247,86 @@ namespace xd::reg {
       return Next::template get<Reg_t>();
     }
 
+    // Lookups by ID or name index into tables built at compile time, with
+    // one entry per register, rather than walking the context
+    template <size_t index>
+    using Level = typename _nth_level_impl<This, index>::Level;
+
+    template <typename Self_t, typename FoundFn, size_t index>
+    static void _found_at(Self_t &self, FoundFn &ff) {
+      using Reg_t = typename Level<index>::Register;
+      ff(Level<index>::template metadata_of<Reg_t>, self.template get<Reg_t>());
+    }
+
+    template <typename FoundFn, size_t index>
+    static void _metadata_found_at(FoundFn &ff) {
+      using Reg_t = typename Level<index>::Register;
+      ff(Level<index>::template metadata_of<Reg_t>);
+    }
+
+    template <typename Self_t, typename FoundFn, size_t... indices>
+    static constexpr auto _make_jump_table(std::index_sequence<indices...>) {
+      return std::array<void (*)(Self_t&, FoundFn&), sizeof...(indices)>{{
+        &_found_at<Self_t, FoundFn, indices>...
+      }};
+    }
+
+    template <typename FoundFn, size_t... indices>
+    static constexpr auto _make_metadata_jump_table(std::index_sequence<indices...>) {
+      return std::array<void (*)(FoundFn&), sizeof...(indices)>{{
+        &_metadata_found_at<FoundFn, indices>...
+      }};
+    }
+
+    template <typename Self_t, typename FoundFn, typename NotFoundFn>
+    static void _find_at(Self_t &self, size_t index, FoundFn &ff, NotFoundFn &nff) {
+      static constexpr auto table = _make_jump_table<Self_t, FoundFn>(
+          std::make_index_sequence<count>());
+      if (index < count)
+        table[index](self, ff);
+      else
+        nff();
+    }
+
+    static constexpr size_t _name_table_size = _next_pow2(4*(1 + sizeof...(Registers_t)));
+
+    struct NameTable {
+      uint32_t seed;
+      std::array<size_t, _name_table_size> slots; // register index, or count if empty
+    };
+
+    static constexpr std::array<std::string_view, 1 + sizeof...(Registers_t)> _names() {
+      return {{ Register_t::name, Registers_t::name... }};
+    }
+
+    // Searches for a seed under which no two names share a slot
+    static constexpr NameTable _make_name_table() {
+      const auto names = _names();
+      for (uint32_t seed = 0;; ++seed) {
+        NameTable table{seed, {}};
+        for (auto &slot : table.slots)
+          slot = count;
+
+        bool collision = false;
+        for (size_t i = 0; i < count && !collision; ++i) {
+          auto &slot = table.slots[_hash_name(names[i], seed) & (_name_table_size-1)];
+          collision = (slot != count);
+          slot = i;
+        }
+
+        if (!collision)
+          return table;
+      }
+    }
+
+    static size_t _index_of_name(std::string_view name) {
+      static constexpr auto names = _names();
+      static constexpr auto table = _make_name_table();
+
+      const auto index = table.slots[_hash_name(name, table.seed) & (_name_table_size-1)];
+      return (index < count && names[index] == name) ? index : count;
+    }
+
   public:
     using Register = Register_t;
 
@@ -218,6 +337,7 @@ namespace xd::reg {
     static constexpr auto id = _id;
     static constexpr auto base = _base;
     static constexpr size_t size = sizeof(typename Register_t::Value) + Next::size;
+    static constexpr size_t count = 1 + Next::count;
 
     template <typename Reg_t>
     static constexpr size_t offset_of =
@@ -274,9 +394,7 @@ namespace xd::reg {
     };
 
     static bool is_valid_id(size_t target_id) {
-      return (id == target_id)
-        ? true
-        : Next::is_valid_id(target_id-1);
+      return target_id - id < count;
     }
 
     template <typename MatchFn, typename FoundFn, typename NotFoundFn>
@@ -296,25 +414,35 @@ namespace xd::reg {
     }
 
     template <typename FoundFn, typename NotFoundFn>
-    void find_by_id(size_t id, FoundFn ff, NotFoundFn nff) const {
-      find([&](const auto &md) {
-        return md.id == id;
-      }, ff, nff);
+    void find_by_id(size_t target_id, FoundFn ff, NotFoundFn nff) const {
+      _find_at(*this, target_id - id, ff, nff);
     }
 
     template <typename FoundFn, typename NotFoundFn>
-    void find_by_id(size_t id, FoundFn ff, NotFoundFn nff) {
-      find([&](const auto &md) {
-        return md.id == id;
-      }, ff, nff);
+    void find_by_id(size_t target_id, FoundFn ff, NotFoundFn nff) {
+      _find_at(*this, target_id - id, ff, nff);
     }
 
     template <typename FoundFn, typename NotFoundFn>
-    static void find_metadata_by_id(size_t id, FoundFn ff, NotFoundFn nff) {
-      if (id == 0)
-        ff(metadata_of<Register_t>);
+    void find_by_name(std::string_view name, FoundFn ff, NotFoundFn nff) const {
+      _find_at(*this, _index_of_name(name), ff, nff);
+    }
+
+    template <typename FoundFn, typename NotFoundFn>
+    void find_by_name(std::string_view name, FoundFn ff, NotFoundFn nff) {
+      _find_at(*this, _index_of_name(name), ff, nff);
+    }
+
+    template <typename FoundFn, typename NotFoundFn>
+    static void find_metadata_by_id(size_t target_id, FoundFn ff, NotFoundFn nff) {
+      static constexpr auto table = _make_metadata_jump_table<FoundFn>(
+          std::make_index_sequence<count>());
+
+      const auto index = target_id - id;
+      if (index < count)
+        table[index](ff);
       else
-        Next::find_metadata_by_id(id-1, ff, nff);
+        nff();
     }
 
     void clear() {
@@ -330,6 +458,19 @@ namespace xd::reg {
   template <typename... Registers_t>
   using RegisterContext = _RegisterContext<0, 0, Registers_t...>;
 
+  namespace {
+    template <typename Context1_t, typename Context2_t>
+    struct _concat_impl;
+
+    template <typename... Registers1_t, typename... Registers2_t>
+    struct _concat_impl<RegisterContext<Registers1_t...>, RegisterContext<Registers2_t...>> {
+      using Context = RegisterContext<Registers1_t..., Registers2_t...>;
+    };
+  }
+
+  template <typename Context1_t, typename Context2_t>
+  using ConcatRegisterContexts = typename _concat_impl<Context1_t, Context2_t>::Context;
+
 }
 
 #endif //XENDBG_REGISTER_CONTEXT_HPP
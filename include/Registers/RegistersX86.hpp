@@ -22,6 +22,9 @@
 #ifndef XENDBG_REGISTERSX86_HPP
 #define XENDBG_REGISTERSX86_HPP
 
+#include <cstddef>
+#include <cstdint>
+
 #include "Register.hpp"
 
 namespace xd::reg::x86 {
@@ -31,6 +34,90 @@ namespace xd::reg::x86 {
   DECLARE_REGISTER(cr4,      uint64_t, -1);
   DECLARE_REGISTER(msr_efer, uint64_t, -1);
 
+  // x87/SSE state, as laid out in the FXSAVE area. The x87 control
+  // registers are widened to 32 bits, as in GDB's org.gnu.gdb.i386.core.
+  using Float80 = RegisterBytes<10>;
+  using Vector128 = RegisterBytes<16>;
+
+  DECLARE_REGISTER(ftag,     uint32_t, -1); // Full tag word, as in FSAVE
+  DECLARE_REGISTER(fiseg,    uint32_t, -1);
+  DECLARE_REGISTER(fioff,    uint32_t, -1);
+  DECLARE_REGISTER(foseg,    uint32_t, -1);
+  DECLARE_REGISTER(fooff,    uint32_t, -1);
+  DECLARE_REGISTER(fop,      uint32_t, -1);
+
+  /*
+   * FXSAVE only keeps an abridged tag byte, with one bit per physical
+   * register saying whether it is empty. Clients expect the full tag word,
+   * with two bits per register, so the rest is worked out from the register
+   * contents the same way GDB does it for FXSAVE areas of native processes.
+   */
+  namespace fxsave {
+
+    constexpr size_t FSW_OFFSET = 2;
+    constexpr size_t FTW_OFFSET = 4;
+    constexpr size_t ST0_OFFSET = 32;
+    constexpr size_t ST_STRIDE = 16;
+
+    enum Tag : uint16_t {
+      TAG_VALID = 0,
+      TAG_ZERO = 1,
+      TAG_SPECIAL = 2,
+      TAG_EMPTY = 3,
+    };
+
+    inline Tag get_tag(const uint8_t *st) {
+      const bool integer = st[7] & 0x80;
+      const uint16_t exponent = ((st[9] & 0x7F) << 8) | st[8];
+      const bool fraction_zero = !(st[0] | st[1] | st[2] | st[3] |
+                                   st[4] | st[5] | st[6] | (st[7] & 0x7F));
+
+      if (exponent == 0x7FFF)
+        return TAG_SPECIAL;
+      if (exponent == 0)
+        return (fraction_zero && !integer) ? TAG_ZERO : TAG_SPECIAL;
+      return integer ? TAG_VALID : TAG_SPECIAL;
+    }
+
+    // Widens the abridged tag of an FXSAVE area to the full tag word. The
+    // STn registers are stored in stack order, so physical register i is
+    // ST((i - TOP) mod 8).
+    inline uint16_t get_full_tag_word(const uint8_t *area) {
+      const uint16_t fsw = area[FSW_OFFSET] | (area[FSW_OFFSET+1] << 8);
+      const uint8_t abridged = area[FTW_OFFSET];
+      const unsigned top = (fsw >> 11) & 0x7;
+
+      uint16_t ftw = 0;
+      for (unsigned i = 0; i < 8; ++i) {
+        const auto st = area + ST0_OFFSET + ST_STRIDE*((i + 8 - top) % 8);
+        const auto tag = (abridged & (1 << i)) ? get_tag(st) : TAG_EMPTY;
+        ftw |= tag << (2*i);
+      }
+      return ftw;
+    }
+
+    // Narrows a full tag word to the abridged one: only emptiness is kept
+    inline uint8_t get_abridged_tag(uint16_t ftw) {
+      uint8_t abridged = 0;
+      for (unsigned i = 0; i < 8; ++i)
+        if (((ftw >> (2*i)) & 0x3) != TAG_EMPTY)
+          abridged |= 1 << i;
+      return abridged;
+    }
+
+    // Converters for an ftag RawField spanning the whole FXSAVE area
+    inline void read_ftag(const uint8_t *area, uint8_t *bytes) {
+      const auto ftw = get_full_tag_word(area);
+      bytes[0] = ftw & 0xFF;
+      bytes[1] = ftw >> 8;
+    }
+
+    inline void write_ftag(uint8_t *area, const uint8_t *bytes) {
+      area[FTW_OFFSET] = get_abridged_tag(bytes[0] | (bytes[1] << 8));
+    }
+
+  }
+
 }
 
 #endif //XENDBG_REGISTERSX86_HPP
@@ -38,19 +38,55 @@ namespace xd::reg::x86_32 {
   DECLARE_REGISTER(ebp,    uint32_t, 6);
   DECLARE_REGISTER(esp,    uint32_t, 7);
   DECLARE_REGISTER(eip,    uint32_t, 8);
-  DECLARE_REGISTER(eflags, uint16_t, 9);
+  // As in GDB's org.gnu.gdb.i386.core, segment registers are 32 bits wide
+  DECLARE_REGISTER(eflags, uint32_t, 9);
   DECLARE_REGISTER(ss,     uint32_t, -1);
-  DECLARE_REGISTER(cs,     uint16_t, -1);
-  DECLARE_REGISTER(ds,     uint16_t, -1);
-  DECLARE_REGISTER(es,     uint16_t, -1);
-  DECLARE_REGISTER(fs,     uint16_t, -1);
-  DECLARE_REGISTER(gs,     uint16_t, -1);
+  DECLARE_REGISTER(cs,     uint32_t, -1);
+  DECLARE_REGISTER(ds,     uint32_t, -1);
+  DECLARE_REGISTER(es,     uint32_t, -1);
+  DECLARE_REGISTER(fs,     uint32_t, -1);
+  DECLARE_REGISTER(gs,     uint32_t, -1);
 
   using RegistersX86_32 = RegisterContext<
     eax, ebx, ecx, edx, esp, ss, ebp, esi, edi,
     eip, eflags, cs, ds, es, fs, gs,
     x86::cr0, x86::cr3, x86::cr4, x86::msr_efer>;
 
+  DECLARE_REGISTER(st0,    x86::Float80, 11);
+  DECLARE_REGISTER(st1,    x86::Float80, 12);
+  DECLARE_REGISTER(st2,    x86::Float80, 13);
+  DECLARE_REGISTER(st3,    x86::Float80, 14);
+  DECLARE_REGISTER(st4,    x86::Float80, 15);
+  DECLARE_REGISTER(st5,    x86::Float80, 16);
+  DECLARE_REGISTER(st6,    x86::Float80, 17);
+  DECLARE_REGISTER(st7,    x86::Float80, 18);
+  DECLARE_REGISTER(fctrl,  uint32_t, 37);
+  DECLARE_REGISTER(fstat,  uint32_t, 38);
+  DECLARE_REGISTER(mxcsr,  uint32_t, 39);
+  DECLARE_REGISTER(xmm0,   x86::Vector128, 21);
+  DECLARE_REGISTER(xmm1,   x86::Vector128, 22);
+  DECLARE_REGISTER(xmm2,   x86::Vector128, 23);
+  DECLARE_REGISTER(xmm3,   x86::Vector128, 24);
+  DECLARE_REGISTER(xmm4,   x86::Vector128, 25);
+  DECLARE_REGISTER(xmm5,   x86::Vector128, 26);
+  DECLARE_REGISTER(xmm6,   x86::Vector128, 27);
+  DECLARE_REGISTER(xmm7,   x86::Vector128, 28);
+
+  // Grouped as in GDB's org.gnu.gdb.i386.{core,sse} features
+  using RegistersX86_32X87 = RegisterContext<
+    st0, st1, st2, st3, st4, st5, st6, st7,
+    fctrl, fstat, x86::ftag, x86::fiseg, x86::fioff, x86::foseg, x86::fooff,
+    x86::fop>;
+
+  using RegistersX86_32SSE = RegisterContext<
+    xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+    mxcsr>;
+
+  // Everything described to GDB clients, in 'g' packet order
+  using RegistersX86_32Target = ConcatRegisterContexts<
+    ConcatRegisterContexts<RegistersX86_32, RegistersX86_32X87>,
+    RegistersX86_32SSE>;
+
 }
 
 #endif //XENDBG_REGISTERS_X86_HPP
@@ -46,19 +46,89 @@ namespace xd::reg::x86_64 {
   DECLARE_REGISTER(r14,    uint64_t, 14);
   DECLARE_REGISTER(r15,    uint64_t, 15);
   DECLARE_REGISTER(rip,    uint64_t, 16);
-  DECLARE_REGISTER(rflags, uint64_t, 17);
-  DECLARE_REGISTER(fs,     uint16_t, -1);
-  DECLARE_REGISTER(gs,     uint16_t, -1);
-  DECLARE_REGISTER(cs,     uint16_t, -1);
-  DECLARE_REGISTER(ds,     uint16_t, -1);
-  DECLARE_REGISTER(ss,     uint16_t, -1);
+  // Flags and segment registers are 32 bits wide, as in GDB's
+  // org.gnu.gdb.i386.core; the upper half of RFLAGS is reserved
+  DECLARE_REGISTER_ALTNAME(rflags, eflags, uint32_t, 49);
+  DECLARE_REGISTER(es,     uint32_t, -1);
+  DECLARE_REGISTER(fs,     uint32_t, -1);
+  DECLARE_REGISTER(gs,     uint32_t, -1);
+  DECLARE_REGISTER(cs,     uint32_t, -1);
+  DECLARE_REGISTER(ds,     uint32_t, -1);
+  DECLARE_REGISTER(ss,     uint32_t, -1);
 
   using RegistersX86_64 = RegisterContext<
     rax, rbx, rcx, rdx, rsp, rbp, rsi, rdi,
     r8, r9, r10, r11, r12, r13, r14, r15,
-    rip, rflags, cs, fs, gs, ds, ss,
+    rip, rflags, cs, fs, gs, ds, es, ss,
     x86::cr0, x86::cr3, x86::cr4, x86::msr_efer>;
 
+  DECLARE_REGISTER(st0,    x86::Float80, 33);
+  DECLARE_REGISTER(st1,    x86::Float80, 34);
+  DECLARE_REGISTER(st2,    x86::Float80, 35);
+  DECLARE_REGISTER(st3,    x86::Float80, 36);
+  DECLARE_REGISTER(st4,    x86::Float80, 37);
+  DECLARE_REGISTER(st5,    x86::Float80, 38);
+  DECLARE_REGISTER(st6,    x86::Float80, 39);
+  DECLARE_REGISTER(st7,    x86::Float80, 40);
+  DECLARE_REGISTER(fctrl,  uint32_t, 65);
+  DECLARE_REGISTER(fstat,  uint32_t, 66);
+  DECLARE_REGISTER(mxcsr,  uint32_t, 64);
+  DECLARE_REGISTER(xmm0,   x86::Vector128, 17);
+  DECLARE_REGISTER(xmm1,   x86::Vector128, 18);
+  DECLARE_REGISTER(xmm2,   x86::Vector128, 19);
+  DECLARE_REGISTER(xmm3,   x86::Vector128, 20);
+  DECLARE_REGISTER(xmm4,   x86::Vector128, 21);
+  DECLARE_REGISTER(xmm5,   x86::Vector128, 22);
+  DECLARE_REGISTER(xmm6,   x86::Vector128, 23);
+  DECLARE_REGISTER(xmm7,   x86::Vector128, 24);
+  DECLARE_REGISTER(xmm8,   x86::Vector128, 25);
+  DECLARE_REGISTER(xmm9,   x86::Vector128, 26);
+  DECLARE_REGISTER(xmm10,  x86::Vector128, 27);
+  DECLARE_REGISTER(xmm11,  x86::Vector128, 28);
+  DECLARE_REGISTER(xmm12,  x86::Vector128, 29);
+  DECLARE_REGISTER(xmm13,  x86::Vector128, 30);
+  DECLARE_REGISTER(xmm14,  x86::Vector128, 31);
+  DECLARE_REGISTER(xmm15,  x86::Vector128, 32);
+  DECLARE_REGISTER(ymm0h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm1h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm2h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm3h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm4h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm5h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm6h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm7h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm8h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm9h,  x86::Vector128, -1);
+  DECLARE_REGISTER(ymm10h, x86::Vector128, -1);
+  DECLARE_REGISTER(ymm11h, x86::Vector128, -1);
+  DECLARE_REGISTER(ymm12h, x86::Vector128, -1);
+  DECLARE_REGISTER(ymm13h, x86::Vector128, -1);
+  DECLARE_REGISTER(ymm14h, x86::Vector128, -1);
+  DECLARE_REGISTER(ymm15h, x86::Vector128, -1);
+
+  // Grouped as in GDB's org.gnu.gdb.i386.{core,sse,avx} features
+  using RegistersX86_64X87 = RegisterContext<
+    st0, st1, st2, st3, st4, st5, st6, st7,
+    fctrl, fstat, x86::ftag, x86::fiseg, x86::fioff, x86::foseg, x86::fooff,
+    x86::fop>;
+
+  using RegistersX86_64SSE = RegisterContext<
+    xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+    xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15,
+    mxcsr>;
+
+  // The upper halves of the YMM registers; the lower halves are XMM
+  using RegistersX86_64AVX = RegisterContext<
+    ymm0h, ymm1h, ymm2h, ymm3h, ymm4h, ymm5h, ymm6h, ymm7h,
+    ymm8h, ymm9h, ymm10h, ymm11h, ymm12h, ymm13h, ymm14h, ymm15h>;
+
+  // Everything described to GDB clients, in 'g' packet order
+  using RegistersX86_64Target = ConcatRegisterContexts<
+    ConcatRegisterContexts<
+      ConcatRegisterContexts<RegistersX86_64, RegistersX86_64X87>,
+      RegistersX86_64SSE>,
+    RegistersX86_64AVX>;
+
 }
 
 #endif //XENDBG_REGISTERS_X86_64_HPP
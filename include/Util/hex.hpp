@@ -0,0 +1,109 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_UTIL_HEX_HPP
+#define XENDBG_UTIL_HEX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace xd::util::hex {
+
+  namespace detail {
+    constexpr char DIGITS[] = "0123456789abcdef";
+
+    // The two lowercase hex digits of every byte value
+    constexpr std::array<std::array<char, 2>, 256> make_encode_table() {
+      std::array<std::array<char, 2>, 256> table{};
+      for (size_t i = 0; i < 256; ++i)
+        table[i] = { DIGITS[i >> 4], DIGITS[i & 0xf] };
+      return table;
+    }
+
+    // The GDB checksum contribution of those two digits
+    constexpr std::array<uint8_t, 256> make_checksum_table() {
+      std::array<uint8_t, 256> table{};
+      for (size_t i = 0; i < 256; ++i)
+        table[i] = (uint8_t)(DIGITS[i >> 4] + DIGITS[i & 0xf]);
+      return table;
+    }
+
+    // The value of every hex digit character, or 0xFF for anything else
+    constexpr std::array<uint8_t, 256> make_decode_table() {
+      std::array<uint8_t, 256> table{};
+      for (size_t i = 0; i < 256; ++i)
+        table[i] = 0xFF;
+      for (uint8_t i = 0; i < 10; ++i)
+        table['0' + i] = i;
+      for (uint8_t i = 0; i < 6; ++i) {
+        table['a' + i] = 0xa + i;
+        table['A' + i] = 0xa + i;
+      }
+      return table;
+    }
+
+    constexpr auto ENCODE_TABLE = make_encode_table();
+    constexpr auto CHECKSUM_TABLE = make_checksum_table();
+    constexpr auto DECODE_TABLE = make_decode_table();
+  }
+
+  // Value of a single hex digit, or -1 if c isn't one
+  inline int digit_value(char c) {
+    const auto value = detail::DECODE_TABLE[(uint8_t)c];
+    return value == 0xFF ? -1 : value;
+  }
+
+  // Writes 2*length chars to out. Returns the sum of the chars written,
+  // i.e. their contribution to a GDB packet checksum.
+  inline uint8_t encode(const void *data, size_t length, char *out) {
+    const auto bytes = (const uint8_t*)data;
+    uint8_t checksum = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+      const auto &digits = detail::ENCODE_TABLE[bytes[i]];
+      out[2*i] = digits[0];
+      out[2*i + 1] = digits[1];
+      checksum += detail::CHECKSUM_TABLE[bytes[i]];
+    }
+
+    return checksum;
+  }
+
+  // Reads 2*length chars from in. Returns false if any of them isn't a hex
+  // digit, in which case the contents of out are unspecified.
+  inline bool decode(const char *in, size_t length, void *out) {
+    const auto bytes = (uint8_t*)out;
+    uint8_t invalid = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+      const auto hi = detail::DECODE_TABLE[(uint8_t)in[2*i]];
+      const auto lo = detail::DECODE_TABLE[(uint8_t)in[2*i + 1]];
+      invalid |= hi | lo;
+      bytes[i] = (uint8_t)((hi << 4) | lo);
+    }
+
+    return !(invalid & 0xF0);
+  }
+
+}
+
+#endif //XENDBG_UTIL_HEX_HPP
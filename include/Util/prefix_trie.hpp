@@ -0,0 +1,115 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_UTIL_PREFIX_TRIE_HPP
+#define XENDBG_UTIL_PREFIX_TRIE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace xd::util {
+
+  /*
+   * A fixed set of keys laid out as a trie at compile time. Nodes are stored
+   * first-child/next-sibling in a flat array, so lookup is a walk over the
+   * input with no hashing or allocation. Size it with trie_size(keys).
+   */
+  template <size_t MaxNodes_v>
+  class PrefixTrie {
+  private:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    struct Node {
+      char ch = '\0';
+      uint16_t first_child = NONE;
+      uint16_t next_sibling = NONE;
+      uint16_t value = NONE;
+    };
+
+  public:
+    template <size_t N>
+    constexpr explicit PrefixTrie(const std::array<std::string_view, N> &keys)
+      : _nodes(), _size(1)
+    {
+      static_assert(MaxNodes_v < NONE, "Too many trie nodes");
+      for (size_t i = 0; i < N; ++i)
+        insert(keys[i], i);
+    }
+
+    // Index of the longest key that is a prefix of s
+    constexpr std::optional<size_t> find_longest_prefix(std::string_view s) const {
+      uint16_t found = NONE, node = 0;
+
+      for (const auto c : s) {
+        node = find_child(node, c);
+        if (node == NONE)
+          break;
+        if (_nodes[node].value != NONE)
+          found = _nodes[node].value;
+      }
+
+      if (found == NONE)
+        return std::nullopt;
+      return found;
+    }
+
+  private:
+    std::array<Node, MaxNodes_v> _nodes;
+    size_t _size;
+
+    constexpr uint16_t find_child(uint16_t node, char c) const {
+      auto child = _nodes[node].first_child;
+      while (child != NONE && _nodes[child].ch != c)
+        child = _nodes[child].next_sibling;
+      return child;
+    }
+
+    constexpr void insert(std::string_view key, size_t value) {
+      uint16_t node = 0;
+      for (const auto c : key) {
+        auto child = find_child(node, c);
+        if (child == NONE) {
+          child = (uint16_t)_size++;
+          _nodes[child].ch = c;
+          _nodes[child].next_sibling = _nodes[node].first_child;
+          _nodes[node].first_child = child;
+        }
+        node = child;
+      }
+      _nodes[node].value = (uint16_t)value;
+    }
+  };
+
+  // Upper bound on the number of nodes needed to hold keys
+  template <size_t N>
+  constexpr size_t trie_size(const std::array<std::string_view, N> &keys) {
+    size_t size = 1;
+    for (const auto &key : keys)
+      size += key.size();
+    return size;
+  }
+
+}
+
+#endif //XENDBG_UTIL_PREFIX_TRIE_HPP
@@ -22,6 +22,7 @@
 #ifndef XENDBG_UTIL_STRING_HPP
 #define XENDBG_UTIL_STRING_HPP
 
+#include <algorithm>
 #include <string>
 
 namespace xd::util::string {
@@ -28,8 +28,13 @@
 #include <Registers/RegistersX86Any.hpp>
 
 #include "Common.hpp"
+#include "DomainInfoCache.hpp"
+#include "ForeignMemoryCache.hpp"
 #include "PagePermissions.hpp"
 #include "PageTableEntry.hpp"
+#include "PageTableWalker.hpp"
+#include "RegisterCache.hpp"
+#include "TranslationCache.hpp"
 #include "XenCall.hpp"
 #include "XenForeignMemory.hpp"
 
@@ -39,6 +44,21 @@ namespace xd::xen {
 
   class Domain {
   public:
+    /**
+     * How guest memory gets copied in or out. Mapping pays for an mmap (and
+     * the page table walk) up front but is free for as long as the page stays
+     * in the mapping cache; guestmemio has the hypervisor translate and copy
+     * in a single hypercall, which wins for tiny one-off accesses.
+     */
+    enum class MemoryBackend {
+      Auto,
+      ForeignMapping,
+      GuestMemIO,
+    };
+
+    // Accesses at most this large are candidates for guestmemio
+    static constexpr size_t GUEST_MEMIO_MAX_SIZE = 64;
+
     Domain(DomID domid, std::shared_ptr<Xen> xen);
     virtual ~Domain() = default;
 
@@ -54,19 +74,35 @@ namespace xd::xen {
     std::string get_kernel_path() const;
     DomInfo get_dominfo() const;
     int get_word_size() const;
+    // Refetches the above the next time they are asked for
+    void refresh_dominfo() const;
+    const DomainInfoCache &get_info_cache() const { return *_info_cache; };
 
     void set_debugging(bool enabled, VCPU_ID vcpu_id) const;
     virtual void set_singlestep(bool enabled, VCPU_ID vcpu_id) const = 0;
 
-    Address translate_foreign_address(Address vaddr, VCPU_ID vcpu_id) const;
+    // The frame a virtual address is in, if it is mapped at all
+    std::optional<Address> translate_foreign_address(Address vaddr, VCPU_ID vcpu_id) const;
     MemInfo map_meminfo() const;
     std::optional<PageTableEntry> get_page_table_entry(Address address, VCPU_ID vcpu_id) const;
+    PagingMode get_paging_mode(VCPU_ID vcpu_id) const;
+    std::shared_ptr<const RegionMap> get_region_map(VCPU_ID vcpu_id) const;
 
     void set_mem_access(xenmem_access_t access, Address start_address, Address size) const;
     xenmem_access_t get_mem_access(Address pfn) const;
 
     virtual xd::reg::RegistersX86Any get_cpu_context(VCPU_ID vcpu_id) const = 0;
     virtual void set_cpu_context(xd::reg::RegistersX86Any regs, VCPU_ID vcpu_id) const = 0;
+    // All VCPUs' registers, indexed by VCPU ID
+    virtual std::vector<xd::reg::RegistersX86Any> get_cpu_contexts() const;
+    // Registers in the hex encoding used by GDB's 'g' and 'G' packets
+    virtual std::string get_cpu_context_hex(VCPU_ID vcpu_id) const = 0;
+    virtual void set_cpu_context_hex(const std::string &hex, VCPU_ID vcpu_id) const = 0;
+    // Snapshots a VCPU's registers under an ID, until they are restored. The
+    // restore is cached like any other register write, and returns false if
+    // there is no such snapshot for that VCPU.
+    virtual size_t save_cpu_context(VCPU_ID vcpu_id) const = 0;
+    virtual bool restore_cpu_context(size_t save_id, VCPU_ID vcpu_id) const = 0;
 
     void pause_vcpu(VCPU_ID vcpu_id);
     void unpause_vcpu(VCPU_ID vcpu_id);
@@ -82,38 +118,89 @@ namespace xd::xen {
 
     xen_pfn_t get_max_gpfn() const;
 
-    XenCall::DomctlUnion hypercall_domctl(uint32_t command, XenCall::InitFn init = {}, XenCall::CleanupFn cleanup = {}) const;
+    template <typename InitFn_t = XenCall::NoOp, typename CleanupFn_t = XenCall::NoOp>
+    XenCall::DomctlUnion hypercall_domctl(uint32_t command, InitFn_t init = {}, CleanupFn_t cleanup = {}) const {
+      return get_xencall().do_domctl(_domid, command, std::move(init), std::move(cleanup));
+    };
 
     template <typename Memory_t>
     XenForeignMemory::MappedMemory<Memory_t> map_memory(Address address, size_t size, int prot) const {
-      return get_xenforeignmemory().map_by_mfn<Memory_t>(
-          *this, translate_foreign_address(address, 0), address % XC_PAGE_SIZE, size, prot);
+      const auto offset = address % XC_PAGE_SIZE;
+      if (offset + size <= XC_PAGE_SIZE)
+        return map_memory_by_mfn<Memory_t>(
+            translate_mapped_address(address), offset, size, prot);
+
+      // Virtually contiguous pages need not be physically contiguous
+      const auto base = address - offset;
+      const auto num_pages = (offset + size + XC_PAGE_SIZE - 1) >> XC_PAGE_SHIFT;
+      return get_xenforeignmemory().map_by_mfns<Memory_t>(*this, num_pages,
+          [this, base](size_t i) {
+            return translate_mapped_address(base + (i << XC_PAGE_SHIFT));
+          }, offset, prot);
     };
 
     template <typename Memory_t>
     XenForeignMemory::MappedMemory<Memory_t> map_memory_by_mfn(Address mfn, Address offset, size_t size, int prot) const {
-      return get_xenforeignmemory().map_by_mfn<Memory_t>(*this, mfn, offset, size, prot);
+      // Anything contained in a single page goes through the mapping cache
+      if (offset + size > XC_PAGE_SIZE)
+        return get_xenforeignmemory().map_by_mfn<Memory_t>(*this, mfn, offset, size, prot);
+
+      auto page = map_page_cached(mfn, prot);
+      const auto memory = (Memory_t*)((char*)page.get() + offset);
+      return XenForeignMemory::MappedMemory<Memory_t>(memory, std::move(page));
     };
 
+    const ForeignMemoryCache &get_memory_cache() const { return *_memory_cache; };
+    void flush_memory_cache() const { _memory_cache->clear(); };
+    const TranslationCache &get_translation_cache() const { return *_translation_cache; };
+    void flush_translation_cache() const { _translation_cache->flush(); };
+
+    // Register writes are cached until the guest resumes; this writes them
+    // out to the hypervisor right away
+    virtual void sync_cpu_contexts() const = 0;
+    virtual RegisterCacheStats get_register_cache_stats() const = 0;
+
+    // Writes back cached register changes, then drops all state that is only
+    // valid while the guest is stopped. Must be called before the guest
+    // resumes and whenever it may have run without this object knowing.
+    virtual void invalidate_caches() const;
+    // Whether xendbg has paused the domain or the VCPU. Only then is state
+    // about the VCPU cached; while it runs, reads go straight to Xen.
+    bool is_stopped(VCPU_ID vcpu_id) const;
+
     void set_access_required(bool required);
 
+    void read_memory(Address address, void *data, size_t size,
+        MemoryBackend backend = MemoryBackend::Auto) const;
+    void write_memory(Address address, const void *data, size_t size,
+        MemoryBackend backend = MemoryBackend::Auto) const;
+    MemoryBackend choose_memory_backend(Address address, size_t size, int prot) const;
+
     /*
     void reboot() const;
-    void read_memory(Address address, void *data, size_t size) const;
-    void write_memory(Address address, void *data, size_t size) const;
      */
 
   protected:
     DomID _domid;
     std::shared_ptr<Xen> _xen;
     std::vector<bool> _vcpu_pause_state;
+    std::shared_ptr<ForeignMemoryCache> _memory_cache;
+    std::shared_ptr<TranslationCache> _translation_cache;
+    std::shared_ptr<DomainInfoCache> _info_cache;
 
   private:
     void pause_unpause_vcpu(uint32_t hypercall, VCPU_ID vcpu_id);
+    void pause_unpause_vcpus(uint32_t hypercall, const std::vector<VCPU_ID> &vcpu_ids);
     void pause_unpause_vcpus_except(uint32_t hypercall, VCPU_ID vcpu_id);
     void pause_unpause_all_vcpus(uint32_t hypercall);
 
+    XenCall &get_xencall() const;
     XenForeignMemory &get_xenforeignmemory() const;
+    // As translate_foreign_address on VCPU 0, but throws if unmapped
+    Address translate_mapped_address(Address vaddr) const;
+    ForeignMemoryCache::Page map_page_cached(Address mfn, int prot) const;
+    bool is_mapped(Address address, size_t size, int prot) const;
+    void guest_memio(Address address, void *data, size_t size, bool write) const;
   };
 
 }
@@ -33,9 +33,18 @@ namespace xd::xen {
 
     reg::RegistersX86Any get_cpu_context(VCPU_ID vcpu_id) const override;
     void set_cpu_context(reg::RegistersX86Any regs, VCPU_ID vcpu_id) const override;
+    std::vector<reg::RegistersX86Any> get_cpu_contexts() const override;
+    std::string get_cpu_context_hex(VCPU_ID vcpu_id) const override;
+    void set_cpu_context_hex(const std::string &hex, VCPU_ID vcpu_id) const override;
+    size_t save_cpu_context(VCPU_ID vcpu_id) const override;
+    bool restore_cpu_context(size_t save_id, VCPU_ID vcpu_id) const override;
 
     void set_singlestep(bool enabled, VCPU_ID vcpu_id) const override;
 
+    void sync_cpu_contexts() const override;
+    RegisterCacheStats get_register_cache_stats() const override;
+    void invalidate_caches() const override;
+
     XenEventChannel::RingPageAndPort enable_monitor() const;
     void disable_monitor() const;
 
@@ -55,9 +64,23 @@ namespace xd::xen {
     void monitor_guest_request(bool enable, bool sync);
 
   private:
+    using CPUContexts = RegisterCache<struct hvm_hw_cpu>::DirtyContexts;
+    // Upper halves of YMM0-15, from the CPU_XSAVE save record
+    using AVXState = std::array<reg::x86::Vector128, 16>;
+
+    std::shared_ptr<RegisterCache<struct hvm_hw_cpu>> _register_cache;
+    std::shared_ptr<RegisterCache<AVXState>> _avx_cache;
+    std::shared_ptr<std::optional<struct hvm_save_header>> _save_header;
+
     struct hvm_hw_cpu get_cpu_context_raw(VCPU_ID vcpu_id) const;
+    struct hvm_hw_cpu fetch_cpu_context_raw(VCPU_ID vcpu_id) const;
+    AVXState fetch_all_cpu_contexts_raw(VCPU_ID avx_vcpu_id = 0) const;
+    AVXState get_avx_state_raw(VCPU_ID vcpu_id) const;
     void set_cpu_context_raw(struct hvm_hw_cpu context, VCPU_ID vcpu_id) const;
+    struct hvm_save_header get_save_header() const;
+    void write_cpu_contexts_raw(const CPUContexts &contexts) const;
 
+    static AVXState read_avx_state(const uint8_t *data, size_t length);
     static reg::RegistersX86Any convert_regs_from_hvm(const struct hvm_hw_cpu &hvm);
     static struct hvm_hw_cpu convert_regs_to_hvm(const reg::x86_64::RegistersX86_64 &regs, hvm_hw_cpu hvm);
   };
@@ -0,0 +1,85 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_DOMAININFOCACHE_HPP
+#define XENDBG_DOMAININFOCACHE_HPP
+
+#include <cstddef>
+#include <optional>
+
+#include "Common.hpp"
+
+namespace xd::xen {
+
+  /**
+   * Caches a domain's info and word size, neither of which changes much
+   * while it is being debugged. Pausing and unpausing through xendbg updates
+   * the paused flag in place; anything else that may have changed the
+   * domain's state (e.g. a xenstore event, or the guest stopping of its own
+   * accord) must call refresh.
+   */
+  class DomainInfoCache {
+  public:
+    struct Stats {
+      size_t hits;
+      size_t misses;
+      size_t refreshes;
+    };
+
+    DomainInfoCache();
+
+    template <typename FetchFn_t>
+    const DomInfo &get_dominfo(FetchFn_t fetch) {
+      if (_dominfo) {
+        ++_stats.hits;
+      } else {
+        ++_stats.misses;
+        _dominfo = fetch();
+      }
+      return *_dominfo;
+    }
+
+    template <typename FetchFn_t>
+    int get_word_size(FetchFn_t fetch) {
+      if (_word_size) {
+        ++_stats.hits;
+      } else {
+        ++_stats.misses;
+        _word_size = fetch();
+      }
+      return *_word_size;
+    }
+
+    void set_paused(bool paused);
+    void refresh();
+
+    const Stats &get_stats() const { return _stats; };
+    void reset_stats() { _stats = Stats{}; };
+
+  private:
+    std::optional<DomInfo> _dominfo;
+    std::optional<int> _word_size;
+    Stats _stats;
+  };
+
+}
+
+#endif //XENDBG_DOMAININFOCACHE_HPP
@@ -32,12 +32,24 @@ namespace xd::xen {
 
     reg::RegistersX86Any get_cpu_context(VCPU_ID vcpu_id) const override;
     void set_cpu_context(reg::RegistersX86Any regs, VCPU_ID vcpu_id) const override;
+    std::string get_cpu_context_hex(VCPU_ID vcpu_id) const override;
+    void set_cpu_context_hex(const std::string &hex, VCPU_ID vcpu_id) const override;
+    size_t save_cpu_context(VCPU_ID vcpu_id) const override;
+    bool restore_cpu_context(size_t save_id, VCPU_ID vcpu_id) const override;
 
     void set_singlestep(bool enabled, VCPU_ID vcpu_id) const override;
 
+    void sync_cpu_contexts() const override;
+    RegisterCacheStats get_register_cache_stats() const override;
+    void invalidate_caches() const override;
+
   private:
+    std::shared_ptr<RegisterCache<vcpu_guest_context_any_t>> _register_cache;
+
     vcpu_guest_context_any_t get_cpu_context_raw(VCPU_ID vcpu_id) const;
+    vcpu_guest_context_any_t fetch_cpu_context_raw(VCPU_ID vcpu_id) const;
     void set_cpu_context_raw(vcpu_guest_context_any_t context, VCPU_ID vcpu_id) const;
+    void write_cpu_context_raw(vcpu_guest_context_any_t context, VCPU_ID vcpu_id) const;
 
     static reg::x86_64::RegistersX86_64 convert_regs_from_pv64(
         const vcpu_guest_context_any_t &pv);
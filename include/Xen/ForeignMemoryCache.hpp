@@ -0,0 +1,139 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_FOREIGNMEMORYCACHE_HPP
+#define XENDBG_FOREIGNMEMORYCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Common.hpp"
+#include "XenForeignMemory.hpp"
+
+namespace xd::xen {
+
+  /**
+   * Bounded LRU cache of single-page foreign mappings, keyed by frame number
+   * and protection. Pages handed out keep their mapping alive independently
+   * of the cache, so an entry is never evicted or unmapped while in use.
+   *
+   * All bookkeeping is allocated up front: entries live in a fixed set of
+   * slots linked into an intrusive LRU list, and are indexed by an
+   * open-addressing hash table, so neither hits nor misses allocate.
+   */
+  class ForeignMemoryCache {
+  public:
+    using Page = std::shared_ptr<void>;
+
+    struct Stats {
+      size_t hits;
+      size_t misses;
+      size_t evictions;
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    explicit ForeignMemoryCache(size_t capacity = DEFAULT_CAPACITY);
+
+    template <typename MapFn_t>
+    Page get(Address mfn, int prot, MapFn_t map_page) {
+      const auto key = make_key(mfn, prot);
+
+      const auto found = find(key);
+      if (found != NONE) {
+        ++_stats.hits;
+        unlink(found);
+        link_front(found);
+        return pin(found);
+      }
+
+      ++_stats.misses;
+      const auto slot = claim();
+      if (slot == NONE) {
+        // Every slot is in use; fall back to a mapping of its own
+        auto mapping = std::make_shared<XenForeignMemory::MappedMemory<void>>(map_page());
+        return Page(mapping, mapping->get());
+      }
+
+      _slots[slot]->mapping = map_page();
+      insert(key, slot);
+      return pin(slot);
+    }
+
+    bool contains(Address mfn, int prot) const {
+      return find(make_key(mfn, prot)) != NONE;
+    }
+
+    void clear();
+
+    size_t get_size() const { return _size; };
+    size_t get_capacity() const { return _slots.size(); };
+    const Stats &get_stats() const { return _stats; };
+    void reset_stats() { _stats = Stats{}; };
+
+  private:
+    using Key = uint64_t;
+    using Index = uint32_t;
+
+    static constexpr Index NONE = UINT32_MAX;
+
+    struct Slot {
+      XenForeignMemory::MappedMemory<void> mapping;
+      Key key = 0;
+      Index prev = NONE;
+      Index next = NONE;
+      bool cached = false;
+    };
+
+    static Key make_key(Address mfn, int prot) {
+      return (mfn << 3) | (prot & 0x7);
+    }
+
+    size_t home(Key key) const {
+      return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (_table.size() - 1);
+    }
+
+    // A slot is in use while any page handed out for it is still alive.
+    bool is_pinned(Index slot) const { return _slots[slot].use_count() > 1; };
+
+    Page pin(Index slot) const {
+      return Page(_slots[slot], _slots[slot]->mapping.get());
+    }
+
+    Index find(Key key) const;
+    Index claim();
+    void insert(Key key, Index slot);
+    void remove(Index slot);
+    void unlink(Index slot);
+    void link_front(Index slot);
+
+    std::vector<std::shared_ptr<Slot>> _slots;
+    std::vector<Index> _table;
+    Index _head, _tail;
+    size_t _size;
+    Stats _stats;
+  };
+
+}
+
+#endif //XENDBG_FOREIGNMEMORYCACHE_HPP
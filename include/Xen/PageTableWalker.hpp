@@ -0,0 +1,104 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_PAGETABLEWALKER_HPP
+#define XENDBG_PAGETABLEWALKER_HPP
+
+#include <array>
+#include <functional>
+#include <optional>
+
+#include "Common.hpp"
+#include "PageTableEntry.hpp"
+#include "XenForeignMemory.hpp"
+
+namespace xd::xen {
+
+  class Domain;
+
+  struct PagingMode {
+    unsigned levels;  // 0 if paging is disabled, otherwise 2-5
+    Address root;     // Physical address of the top-level table
+  };
+
+  /**
+   * Walks a guest's page tables, keeping the most recently used table at
+   * each level mapped so that consecutive walks share their upper levels.
+   * A walker is only valid for as long as the paging mode it was created
+   * with, i.e. until the guest next runs.
+   */
+  class PageTableWalker {
+  public:
+    struct Mapping {
+      Address address;  // Virtual address of the start of the (possibly large) page
+      Address size;
+      Address mfn;      // Frame backing the start of the page
+      PageTableEntry pte;
+      bool write, user, execute;  // Effective permissions across all levels
+    };
+
+    using OnMappingFn = std::function<void(const Mapping&)>;
+
+    PageTableWalker(const Domain &domain, PagingMode mode);
+
+    const PagingMode &get_mode() const { return _mode; };
+
+    // The highest virtual address the paging mode can reach: the top of the
+    // 4 GiB space with 2- or 3-level paging, otherwise that of the upper
+    // canonical half
+    Address get_last_address() const {
+      return (_address_bits > 32) ? ~Address(0) : (1ull << _address_bits) - 1;
+    };
+
+    std::optional<Mapping> translate(Address address);
+
+    // Calls on_mapping for each present page overlapping [first, last], in
+    // ascending order, skipping non-present subtrees entirely
+    void walk(Address first, Address last, const OnMappingFn &on_mapping);
+
+  private:
+    struct Table {
+      Address mfn;
+      XenForeignMemory::MappedMemory<char> memory;
+    };
+
+    const Domain &_domain;
+    PagingMode _mode;
+    unsigned _address_bits;
+    std::array<Table, 5> _tables;
+
+    const char *get_table(unsigned level, Address mfn);
+    uint64_t read_entry(unsigned level, Address table, size_t index);
+
+    unsigned get_shift(unsigned level) const;
+    size_t get_num_entries(unsigned level) const;
+    bool is_leaf(unsigned level, uint64_t entry) const;
+    Address get_next_table(uint64_t entry) const;
+    Address to_canonical(Address address) const;
+
+    void walk_level(unsigned level, Address table, Address base,
+        Address first, Address last, bool write, bool user, bool execute,
+        const OnMappingFn &on_mapping);
+  };
+
+}
+
+#endif //XENDBG_PAGETABLEWALKER_HPP
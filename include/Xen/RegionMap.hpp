@@ -0,0 +1,73 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_REGIONMAP_HPP
+#define XENDBG_REGIONMAP_HPP
+
+#include <map>
+
+#include "Common.hpp"
+#include "PageTableWalker.hpp"
+
+namespace xd::xen {
+
+  /**
+   * A guest virtual address space, as seen from one VCPU, reduced to maximal
+   * runs of contiguous pages with identical effective permissions, including
+   * whether they are user or supervisor pages. Built
+   * with a single page table walk; lookups are O(log n).
+   */
+  class RegionMap {
+  public:
+    struct Region {
+      Address start;
+      Address size;
+      bool read, write, execute;
+      bool user;
+
+      bool contains(Address address) const {
+        return address - start < size;
+      }
+    };
+
+    explicit RegionMap(PageTableWalker &walker);
+
+    // Returns the region containing address. If it isn't mapped, returns
+    // the unmapped gap around it instead, with no permissions; the last gap
+    // ends where the paging mode's address space does.
+    Region find(Address address) const;
+
+    template <typename F>
+    void for_each(F f) const {
+      for (const auto &[_, region] : _regions)
+        f(region);
+    }
+
+    size_t get_size() const { return _regions.size(); };
+
+  private:
+    std::map<Address, Region> _regions;
+    Address _last_address;
+  };
+
+}
+
+#endif //XENDBG_REGIONMAP_HPP
@@ -0,0 +1,170 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_REGISTERCACHE_HPP
+#define XENDBG_REGISTERCACHE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "Common.hpp"
+
+namespace xd::xen {
+
+  struct RegisterCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t flushes;
+    size_t write_backs;
+  };
+
+  /**
+   * Per-VCPU cache of raw CPU contexts, as returned by the hypervisor. A
+   * stopped VCPU's context cannot change under us, so it need only be
+   * fetched once per stop. Writes stay local and are marked dirty until
+   * written back, so that any number of register writes cost one setcontext.
+   * Dirty contexts must be written back before the guest gets to run, and
+   * the cache flushed once it has.
+   *
+   * It also holds contexts saved by the debugger for later restoration.
+   * These belong to the debugger rather than to the current stop, so they
+   * survive flushes. Only the most recent MAX_SAVED are kept.
+   */
+  template <typename Context_t>
+  class RegisterCache {
+  public:
+    using DirtyContexts = std::vector<std::pair<VCPU_ID, Context_t>>;
+
+    static constexpr size_t MAX_SAVED = 64;
+
+    RegisterCache()
+      : _stats{} {};
+
+    template <typename FetchFn_t>
+    const Context_t &get(VCPU_ID vcpu_id, FetchFn_t fetch) {
+      auto &entry = get_entry(vcpu_id);
+      if (entry.context) {
+        ++_stats.hits;
+      } else {
+        ++_stats.misses;
+        entry.context = fetch();
+      }
+      return *entry.context;
+    }
+
+    bool contains(VCPU_ID vcpu_id) const {
+      return vcpu_id < _entries.size() && _entries[vcpu_id].context;
+    }
+
+    // Fills in a freshly fetched context, unless one is already cached
+    void insert(VCPU_ID vcpu_id, const Context_t &context) {
+      auto &entry = get_entry(vcpu_id);
+      if (!entry.context)
+        entry.context = context;
+    }
+
+    void set(VCPU_ID vcpu_id, const Context_t &context) {
+      auto &entry = get_entry(vcpu_id);
+      entry.context = context;
+      entry.dirty = true;
+    }
+
+    bool is_dirty() const {
+      return std::any_of(_entries.begin(), _entries.end(),
+          [](const auto &entry) { return entry.dirty; });
+    }
+
+    // Passes all dirty contexts to write in one go; they are only marked
+    // clean if it returns normally
+    template <typename WriteFn_t>
+    void write_back(WriteFn_t write) {
+      DirtyContexts dirty;
+      for (VCPU_ID vcpu_id = 0; vcpu_id < _entries.size(); ++vcpu_id)
+        if (_entries[vcpu_id].dirty)
+          dirty.emplace_back(vcpu_id, *_entries[vcpu_id].context);
+
+      if (dirty.empty())
+        return;
+
+      write(dirty);
+      ++_stats.write_backs;
+
+      for (auto &entry : _entries)
+        entry.dirty = false;
+    }
+
+    // Discards everything, including unwritten changes
+    void flush() {
+      _entries.clear();
+      ++_stats.flushes;
+    }
+
+    // IDs start at 1; GDB clients take 0 to mean failure. IDs only grow,
+    // so the oldest snapshot is always the first.
+    size_t save(VCPU_ID vcpu_id, const Context_t &context) {
+      if (_saved.size() >= MAX_SAVED)
+        _saved.erase(_saved.begin());
+
+      const auto save_id = _next_save_id++;
+      _saved.emplace(save_id, std::make_pair(vcpu_id, context));
+      return save_id;
+    }
+
+    // Each saved context can be restored once, and only to the VCPU it was
+    // saved from
+    std::optional<Context_t> take_saved(size_t save_id, VCPU_ID vcpu_id) {
+      const auto found = _saved.find(save_id);
+      if (found == _saved.end() || found->second.first != vcpu_id)
+        return std::nullopt;
+
+      const auto context = found->second.second;
+      _saved.erase(found);
+      return context;
+    }
+
+    const RegisterCacheStats &get_stats() const { return _stats; };
+    void reset_stats() { _stats = RegisterCacheStats{}; };
+
+  private:
+    struct Entry {
+      std::optional<Context_t> context;
+      bool dirty = false;
+    };
+
+    Entry &get_entry(VCPU_ID vcpu_id) {
+      if (vcpu_id >= _entries.size())
+        _entries.resize(vcpu_id + 1);
+      return _entries[vcpu_id];
+    }
+
+    std::vector<Entry> _entries;
+    std::map<size_t, std::pair<VCPU_ID, Context_t>> _saved;
+    size_t _next_save_id = 1;
+    RegisterCacheStats _stats;
+  };
+
+}
+
+#endif //XENDBG_REGISTERCACHE_HPP
@@ -0,0 +1,105 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef XENDBG_TRANSLATIONCACHE_HPP
+#define XENDBG_TRANSLATIONCACHE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "Common.hpp"
+#include "PageTableWalker.hpp"
+#include "RegionMap.hpp"
+
+namespace xd::xen {
+
+  /**
+   * Software TLB: per-VCPU cache of virtual page to frame translations,
+   * keyed by the page table root (i.e. CR3) they were made under. The paging
+   * mode of each VCPU is itself cached, so that repeated lookups while
+   * stopped need no hypercalls at all. The region map of each VCPU's address
+   * space is kept alongside. Everything must be flushed whenever the guest
+   * gets to run.
+   */
+  class TranslationCache {
+  public:
+    struct Stats {
+      size_t hits;
+      size_t misses;
+      size_t flushes;
+    };
+
+    static constexpr size_t MAX_ENTRIES_PER_VCPU = 4096;
+
+    TranslationCache();
+
+    std::optional<PagingMode> get_paging_mode(VCPU_ID vcpu_id) const;
+    void set_paging_mode(VCPU_ID vcpu_id, PagingMode mode);
+
+    std::shared_ptr<const RegionMap> get_region_map(VCPU_ID vcpu_id) const;
+    void set_region_map(VCPU_ID vcpu_id, std::shared_ptr<const RegionMap> region_map);
+
+    std::optional<Address> lookup(VCPU_ID vcpu_id, Address root, Address vpage);
+    // As lookup, but without counting towards the stats
+    std::optional<Address> peek(VCPU_ID vcpu_id, Address root, Address vpage) const;
+    void insert(VCPU_ID vcpu_id, Address root, Address vpage, Address mfn);
+
+    void flush();
+    void flush_vcpu(VCPU_ID vcpu_id);
+
+    size_t get_size() const;
+    const Stats &get_stats() const { return _stats; };
+    void reset_stats() { _stats = Stats{}; };
+
+  private:
+    struct Key {
+      Address root;
+      Address vpage;
+
+      bool operator==(const Key &other) const {
+        return root == other.root && vpage == other.vpage;
+      }
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key &key) const {
+        return std::hash<Address>()(key.vpage ^ (key.root << 7));
+      }
+    };
+
+    struct VCPUEntries {
+      std::optional<PagingMode> paging_mode;
+      std::shared_ptr<const RegionMap> region_map;
+      std::unordered_map<Key, Address, KeyHash> translations;
+    };
+
+    VCPUEntries &get_vcpu(VCPU_ID vcpu_id);
+
+    std::vector<VCPUEntries> _vcpus;
+    Stats _stats;
+  };
+
+}
+
+#endif //XENDBG_TRANSLATIONCACHE_HPP
@@ -25,11 +25,13 @@
 #include <cstring>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <errno.h>
 
@@ -49,16 +51,85 @@ namespace xd::xen {
 
   public:
     using DomctlUnion = decltype(XenCall::_dummy_domctl.u);
-    using InitFn = std::function<void(DomctlUnion&)>;
-    using CleanupFn = std::function<void()>;
+
+    struct NoOp {
+      template <typename... Args_t>
+      void operator()(Args_t&&...) const {};
+    };
+
+    static constexpr size_t BOUNCE_BUFFER_SIZE = XC_PAGE_SIZE;
 
     explicit XenCall(std::shared_ptr<xc_interface> xenctrl);
 
-    DomctlUnion do_domctl(const Domain &domain, uint32_t command, InitFn init = {}, CleanupFn cleanup = {}) const;
+    // init(u) fills in the command-specific part of the domctl; cleanup()
+    // runs once the hypercall has returned, whether or not it succeeded.
+    // The domctl itself lives in a buffer that is reused across calls.
+    template <typename InitFn_t = NoOp, typename CleanupFn_t = NoOp>
+    DomctlUnion do_domctl(DomID domid, uint32_t command,
+        InitFn_t init = {}, CleanupFn_t cleanup = {}) const
+    {
+      auto &domctl = prepare_domctl(_domctl_buffer.get(), domid, command);
+      init(domctl.u);
+
+      const auto err = submit_domctl();
+      cleanup();
+
+      if (err)
+        throw XenException("Hypercall failed", -err);
+
+      return domctl.u;
+    }
+
+    // Issues count domctls of the same type in a single multicall, with
+    // init(i, u) filling in the i-th. Returns each one's error code (0 on
+    // success), in order.
+    template <typename InitFn_t>
+    std::vector<int> do_domctls(DomID domid, uint32_t command, size_t count,
+        InitFn_t init) const
+    {
+      // The entries and the domctls they point to must all be hypercall-safe
+      const auto entries = (multicall_entry_t*)get_batch_buffer(
+          count * (sizeof(multicall_entry_t) + sizeof(xen_domctl)));
+      const auto domctls = (xen_domctl*)(entries + count);
+
+      for (size_t i = 0; i < count; ++i) {
+        auto &domctl = prepare_domctl(&domctls[i], domid, command);
+        init(i, domctl.u);
+
+        memset(&entries[i], 0, sizeof(entries[i]));
+        entries[i].op = __HYPERVISOR_domctl;
+        entries[i].args[0] = (unsigned long)&domctl;
+      }
+
+      submit_multicall(entries, count);
+
+      std::vector<int> results;
+      results.reserve(count);
+      for (size_t i = 0; i < count; ++i)
+        results.push_back(-(int)entries[i].result);
+      return results;
+    }
+
+    // Locked scratch memory that the hypervisor can safely copy to/from,
+    // for domctls that take a user buffer (e.g. gdbsx_guestmemio)
+    void *get_bounce_buffer() const { return _bounce_buffer.get(); };
 
   private:
+    using Buffer = std::unique_ptr<void, std::function<void(void*)>>;
+
+    static xen_domctl &prepare_domctl(void *buffer, DomID domid, uint32_t command);
+    int submit_domctl() const;
+    void submit_multicall(multicall_entry_t *entries, size_t count) const;
+
+    Buffer alloc_buffer(size_t size) const;
+    void *get_batch_buffer(size_t size) const;
+
     std::shared_ptr<xc_interface> _xenctrl;
     std::unique_ptr<xencall_handle, decltype(&xencall_close)> _xencall;
+    Buffer _bounce_buffer;
+    Buffer _domctl_buffer;
+    mutable Buffer _batch_buffer;
+    mutable size_t _batch_buffer_size;
   };
 
 }
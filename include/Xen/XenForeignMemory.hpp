@@ -40,10 +40,76 @@ namespace xd::xen {
 
   class Domain;
 
+  /**
+   * Move-only handle to a foreign mapping. Either owns the mapping itself
+   * (and unmaps it when destroyed) or pins a page shared with the mapping
+   * cache, in which case no unmapping happens here.
+   */
+  template <typename Memory_t>
+  class MappedMemoryHandle {
+  public:
+    MappedMemoryHandle()
+      : _memory(nullptr), _base(nullptr), _num_pages(0) {};
+
+    MappedMemoryHandle(Memory_t *memory, std::shared_ptr<xenforeignmemory_handle> fmem,
+        void *base, size_t num_pages)
+      : _memory(memory), _fmem(std::move(fmem)), _base(base), _num_pages(num_pages) {};
+
+    MappedMemoryHandle(Memory_t *memory, std::shared_ptr<void> page)
+      : _memory(memory), _base(nullptr), _num_pages(0), _page(std::move(page)) {};
+
+    MappedMemoryHandle(const MappedMemoryHandle &other) = delete;
+    MappedMemoryHandle &operator=(const MappedMemoryHandle &other) = delete;
+
+    MappedMemoryHandle(MappedMemoryHandle &&other) noexcept
+      : _memory(other._memory), _fmem(std::move(other._fmem)), _base(other._base),
+        _num_pages(other._num_pages), _page(std::move(other._page))
+    {
+      other._memory = nullptr;
+      other._base = nullptr;
+    }
+
+    MappedMemoryHandle &operator=(MappedMemoryHandle &&other) noexcept {
+      if (this != &other) {
+        reset();
+        _memory = other._memory;
+        _fmem = std::move(other._fmem);
+        _base = other._base;
+        _num_pages = other._num_pages;
+        _page = std::move(other._page);
+        other._memory = nullptr;
+        other._base = nullptr;
+      }
+      return *this;
+    }
+
+    ~MappedMemoryHandle() { reset(); };
+
+    Memory_t *get() const { return _memory; };
+    explicit operator bool() const { return _memory != nullptr; };
+
+    void reset() {
+      if (_base)
+        xenforeignmemory_unmap(_fmem.get(), _base, _num_pages);
+      _memory = nullptr;
+      _fmem.reset();
+      _base = nullptr;
+      _num_pages = 0;
+      _page.reset();
+    }
+
+  private:
+    Memory_t *_memory;
+    std::shared_ptr<xenforeignmemory_handle> _fmem;
+    void *_base;
+    size_t _num_pages;
+    std::shared_ptr<void> _page;
+  };
+
   class XenForeignMemory {
   public:
     template <typename Memory_t>
-    using MappedMemory = std::shared_ptr<Memory_t>;
+    using MappedMemory = MappedMemoryHandle<Memory_t>;
 
     XenForeignMemory();
 
@@ -51,20 +117,37 @@ namespace xd::xen {
 
     template <typename Memory_t, typename Domain_t>
     MappedMemory<Memory_t> map_by_mfn(const Domain_t &domain, Address base_mfn, Address offset, size_t size, int prot) const {
-      auto fmem = _xen_foreign_memory;
-      auto mem = map_by_mfn_raw(domain, base_mfn, offset, size, prot);
-      auto num_pages = size / XC_PAGE_SIZE;
-
-      return std::shared_ptr<Memory_t>((Memory_t*)mem, [fmem, mem, num_pages](void *memory) {
-        if (memory)
-          xenforeignmemory_unmap(fmem.get(), mem, num_pages);
-      });
+      const auto num_pages = (offset + size + XC_PAGE_SIZE - 1) >> XC_PAGE_SHIFT;
+      return map_by_mfns<Memory_t>(domain, num_pages,
+          [base_mfn](size_t i) { return base_mfn + i; }, offset, prot);
+    }
+
+    // Maps the frames get_mfn(0)...get_mfn(num_pages-1), which need not be
+    // contiguous, in order into a single virtually contiguous region.
+    // get_mfn may itself map single pages, but not multi-page ranges, as
+    // those share the PFN table being filled here.
+    template <typename Memory_t, typename Domain_t, typename GetMFN_t>
+    MappedMemory<Memory_t> map_by_mfns(const Domain_t &domain, size_t num_pages, GetMFN_t get_mfn, Address offset, int prot) const {
+      void *mem;
+      if (num_pages == 1) {
+        xen_pfn_t page = get_mfn(0);
+        mem = map_pfns_raw(domain, &page, 1, prot);
+      } else {
+        const auto pages = get_pfn_table(num_pages);
+        for (size_t i = 0; i < num_pages; ++i)
+          pages[i] = get_mfn(i);
+        mem = map_pfns_raw(domain, pages, num_pages, prot);
+      }
+
+      return MappedMemory<Memory_t>((Memory_t*)((char*)mem + offset),
+          _xen_foreign_memory, mem, num_pages);
     }
 
   private:
     std::shared_ptr<xenforeignmemory_handle> _xen_foreign_memory;
 
-    void *map_by_mfn_raw(const Domain &domain, Address base_mfn, Address offset, size_t size, int prot) const;
+    static xen_pfn_t *get_pfn_table(size_t num_pages);
+    void *map_pfns_raw(const Domain &domain, const xen_pfn_t *pages, size_t num_pages, int prot) const;
   };
 
 }
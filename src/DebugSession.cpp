@@ -40,6 +40,10 @@ void DebugSession::stop() {
     _gdb_server->stop();
 }
 
+void DebugSession::refresh_domain_state() {
+  _debugger->get_domain().refresh_dominfo();
+}
+
 void DebugSession::run(const std::string& address_str, uint16_t port, OnErrorFn on_error) {
   _gdb_server->listen(address_str, port,
     [this, on_error](auto &server, auto connection) {
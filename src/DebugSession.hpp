@@ -43,6 +43,7 @@ namespace xd {
     ~DebugSession();
 
     void stop();
+    void refresh_domain_state();
     void run(const std::string& address_str, uint16_t port, OnErrorFn on_error);
 
   private:
@@ -19,6 +19,9 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <algorithm>
+#include <exception>
+
 #include <Debugger/Debugger.hpp>
 
 using xd::xen::Address;
@@ -50,58 +53,131 @@ void Debugger::detach() {
 }
 
 void Debugger::did_stop(StopReason reason) {
+  // The guest has run since we last looked at it, and may have been paused
+  // by something other than us
+  _domain.invalidate_caches();
+  _domain.refresh_dominfo();
+
   _last_stop_reason = reason;
   if (_on_stop)
     _on_stop(reason);
 }
 
 void Debugger::cleanup() {
-  for (auto it = _breakpoints.cbegin(); it != _breakpoints.cend();)
-    it = remove_breakpoint(it->first);
+  std::vector<Address> addresses;
+  addresses.reserve(_breakpoints.size());
+  for (const auto &[address, _] : _breakpoints)
+    addresses.push_back(address);
+
+  // Already logged per page; detaching should go ahead regardless
+  try {
+    remove_breakpoints(addresses);
+  } catch (const std::exception &) {}
 }
 
-void Debugger::insert_breakpoint(Address address) {
-  spdlog::get(LOGNAME_CONSOLE)->debug("Inserting breakpoint at {0:x}", address);
-
-  if (_breakpoints.count(address)) {
-    spdlog::get(LOGNAME_ERROR)->info(
-        "[!]: Tried to insert breakpoint where one already exists. "
-        "This is generally harmless, but might indicate a failure in estimating the "
-        "next instruction address.",
-        address);
-    return;
+// Calls f(page, begin, end) for each run of addresses in [begin, end) that
+// share a guest page. The addresses must be sorted.
+template <typename F>
+static void for_each_page(const std::vector<Address> &addresses, F f) {
+  for (auto begin = addresses.begin(); begin != addresses.end();) {
+    const auto page = *begin & XC_PAGE_MASK;
+    auto end = begin;
+    while (end != addresses.end() && (*end & XC_PAGE_MASK) == page)
+      ++end;
+
+    f(page, begin, end);
+    begin = end;
   }
+}
 
-  const auto mem_handle = _domain.map_memory<uint8_t>(
-      address, sizeof(uint8_t), PROT_READ | PROT_WRITE);
-  const auto mem = mem_handle.get();
-
-  const auto orig_bytes = *mem;
+static std::vector<Address> sorted_unique(std::vector<Address> addresses) {
+  std::sort(addresses.begin(), addresses.end());
+  addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+  return addresses;
+}
 
-  _breakpoints[address] = orig_bytes;
-  *mem = X86_INT3;
+void Debugger::insert_breakpoint(Address address) {
+  spdlog::get(LOGNAME_CONSOLE)->debug("Inserting breakpoint at {0:x}", address);
+  insert_breakpoints({address});
 }
 
-Debugger::BreakpointMap::iterator Debugger::remove_breakpoint(Address address) {
+void Debugger::remove_breakpoint(Address address) {
   spdlog::get(LOGNAME_CONSOLE)->debug("Removing breakpoint at {0:x}", address);
+  remove_breakpoints({address});
+}
 
-  if (!_breakpoints.count(address)) {
-    spdlog::get(LOGNAME_ERROR)->info(
-        "[!]: Tried to remove infinite loop where one does not exist. "
-        "This is generally harmless, but might indicate a failure in estimating the "
-        "next instruction address.",
-        address);
-    return _breakpoints.end();
+// All or nothing: if a page can't be patched, the breakpoints already
+// inserted are removed again before the error is passed on
+void Debugger::insert_breakpoints(const std::vector<Address> &addresses) {
+  std::vector<Address> inserted;
+  try {
+    for_each_page(sorted_unique(addresses), [&](auto page, auto begin, auto end) {
+      const auto mem_handle = _domain.map_memory<uint8_t>(
+          page, XC_PAGE_SIZE, PROT_READ | PROT_WRITE);
+      const auto mem = mem_handle.get();
+
+      for (auto it = begin; it != end; ++it) {
+        const auto address = *it;
+        if (_breakpoints.count(address)) {
+          spdlog::get(LOGNAME_ERROR)->info(
+              "[!]: Tried to insert breakpoint where one already exists. "
+              "This is generally harmless, but might indicate a failure in estimating the "
+              "next instruction address.",
+              address);
+          continue;
+        }
+
+        auto &byte = mem[address - page];
+        _breakpoints[address] = byte;
+        byte = X86_INT3;
+        inserted.push_back(address);
+      }
+    });
+  } catch (...) {
+    // Pages that fail here keep their breakpoints, which stay recorded
+    try {
+      remove_breakpoints(inserted);
+    } catch (...) {}
+    throw;
   }
+}
 
-  const auto mem_handle = _domain.map_memory<uint8_t>(
-      address, sizeof(uint8_t), PROT_WRITE);
-  const auto mem = mem_handle.get();
-
-  const auto orig_bytes = _breakpoints.at(address);
-  *mem = orig_bytes;
+// Every page is attempted even if some fail, so that as many breakpoints as
+// possible are removed. Those on pages that failed stay recorded, since
+// their int3s are still in the guest, and the first error is passed on.
+void Debugger::remove_breakpoints(const std::vector<Address> &addresses) {
+  std::exception_ptr error;
+  for_each_page(sorted_unique(addresses), [&](auto page, auto begin, auto end) {
+    try {
+      const auto mem_handle = _domain.map_memory<uint8_t>(
+          page, XC_PAGE_SIZE, PROT_READ | PROT_WRITE);
+      const auto mem = mem_handle.get();
+
+      for (auto it = begin; it != end; ++it) {
+        const auto address = *it;
+        const auto bp = _breakpoints.find(address);
+        if (bp == _breakpoints.end()) {
+          spdlog::get(LOGNAME_ERROR)->info(
+              "[!]: Tried to remove breakpoint where one does not exist. "
+              "This is generally harmless, but might indicate a failure in estimating the "
+              "next instruction address.",
+              address);
+          continue;
+        }
+
+        mem[address - page] = bp->second;
+        _breakpoints.erase(bp);
+      }
+    } catch (const std::exception &e) {
+      spdlog::get(LOGNAME_ERROR)->error(
+          "Failed to remove breakpoints on page {0:x}: {1}", page, e.what());
+      if (!error)
+        error = std::current_exception();
+    }
+  });
 
-  return _breakpoints.erase(_breakpoints.find(address));
+  if (error)
+    std::rethrow_exception(error);
 }
 
 void Debugger::insert_watchpoint(Address address, uint32_t bytes, WatchpointType type) {
@@ -113,49 +189,50 @@ void Debugger::remove_watchpoint(Address address, uint32_t bytes, WatchpointType
 }
 
 xd::dbg::MaskedMemory Debugger::read_memory_masking_breakpoints(Address address, size_t length) {
-  const auto mem_handle = _domain.map_memory<char>(
-      address, length, PROT_READ);
-  const auto mem_masked = (unsigned char*)malloc(length);
-  memcpy(mem_masked, mem_handle.get(), length);
-
-  const auto address_end = address + length;
-  for (const auto [bp_address, bp_orig_bytes] : _breakpoints) {
-    if (bp_address >= address && bp_address < address_end) {
-      const auto dist = bp_address - address;
-      *((uint16_t*)(mem_masked + dist)) = bp_orig_bytes;
-    }
-  }
+  auto mem_handle = read_memory(address, length);
+
+  MaskedMemory::Overlay overlay;
+  const auto bp_end = _breakpoints.lower_bound(address + length);
+  for (auto it = _breakpoints.lower_bound(address); it != bp_end; ++it)
+    overlay.emplace_back(it->first - address, it->second);
 
-  return MaskedMemory(mem_masked);
+  return MaskedMemory(std::move(mem_handle), length, std::move(overlay));
 }
 
 void Debugger::write_memory_retaining_breakpoints(Address address, size_t length, void *data) {
-  const auto half_overlap_start_address = address-1;
-  const auto half_overlap_end_address = address+length-1;
-
-  const auto length_orig = length;
-  if (_breakpoints.count(half_overlap_start_address)) {
-    address -= 1;
-    length += 1;
-  }
-  if (_breakpoints.count(half_overlap_end_address))
-    length += 1;
-
-  std::vector<xen::Address> bp_addresses;
-  const auto address_end = address + length_orig;
-  for (const auto [bp_address, _] : _breakpoints) {
-    if (bp_address >= address && bp_address < address_end) {
-      remove_breakpoint(bp_address);
-      bp_addresses.push_back(bp_address);
-    }
+  const auto bytes = (const uint8_t*)data;
+  const auto bp_begin = _breakpoints.lower_bound(address);
+  const auto bp_end = _breakpoints.lower_bound(address + length);
+
+  const auto backend = _domain.choose_memory_backend(address, length, PROT_READ | PROT_WRITE);
+  if (backend == Domain::MemoryBackend::GuestMemIO) {
+    std::vector<uint8_t> patched(bytes, bytes + length);
+    for (auto it = bp_begin; it != bp_end; ++it)
+      patched[it->first - address] = X86_INT3;
+    _domain.write_memory(address, patched.data(), length, backend);
+  } else {
+    const auto mem_handle = _domain.map_memory<uint8_t>(address, length, PROT_READ | PROT_WRITE);
+    const auto mem = mem_handle.get();
+
+    memcpy(mem, bytes, length);
+    for (auto it = bp_begin; it != bp_end; ++it)
+      mem[it->first - address] = X86_INT3;
   }
 
-  const auto mem_handle = _domain.map_memory<char>(address, length, PROT_WRITE);
-  const auto mem_orig = (char*)mem_handle.get() + (length - length_orig);
-  memcpy((void*)mem_orig, data, length_orig);
+  // Breakpoints stay in place; the new data becomes their original bytes
+  for (auto it = bp_begin; it != bp_end; ++it)
+    it->second = bytes[it->first - address];
+
+  spdlog::get(LOGNAME_ERROR)->info("Wrote {0:d} bytes to {1:x}.", length, address);
+}
 
-  spdlog::get(LOGNAME_ERROR)->info("Wrote {0:d} bytes to {1:x}.", length_orig, address);
+xd::dbg::GuestMemory Debugger::read_memory(Address address, size_t length) {
+  const auto backend = _domain.choose_memory_backend(address, length, PROT_READ);
+  if (backend == Domain::MemoryBackend::ForeignMapping)
+    return _domain.map_memory<unsigned char>(address, length, PROT_READ);
 
-  for (const auto &bp_address : bp_addresses)
-    insert_breakpoint(bp_address);
+  // Small enough to copy out rather than map
+  CopiedMemory copy;
+  _domain.read_memory(address, copy.get(), length, backend);
+  return copy;
 }
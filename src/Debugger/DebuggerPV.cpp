@@ -59,7 +59,10 @@ void DebuggerPV::attach() {
 
     handle.stop();
 
+    // Xen paused the domain itself, so the cached dominfo still says it's
+    // running; without this, unpause() below would think there's nothing to do
     auto &domain = self->_domain;
+    domain.refresh_dominfo();
     auto vcpu = (status.vcpu_id == (size_t)-1)
         ? self->_last_single_step_vcpu_id
         : status.vcpu_id;
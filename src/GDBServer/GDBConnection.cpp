@@ -19,27 +19,29 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <array>
+#include <cstring>
 #include <iostream>
-#include <numeric>
-#include <stdexcept>
+#include <memory>
 
 #include <spdlog/spdlog.h>
 
 #include <Globals.hpp>
 #include <GDBServer/GDBConnection.hpp>
-#include <Util/string.hpp>
+#include <Util/prefix_trie.hpp>
 
 using xd::gdb::GDBConnection;
-using xd::gdb::GDBPacket;
 using xd::gdb::req::GDBRequest;
 using xd::gdb::rsp::GDBResponse;
-using xd::util::string::is_prefix;
+using xd::util::PrefixTrie;
+using xd::util::trie_size;
 
 static char ACK_OK[] = "+";
 static char ACK_ERROR[] = "-";
 
 GDBConnection::GDBConnection(std::shared_ptr<uvw::TcpHandle> tcp)
-  : _tcp(std::move(tcp)), _ack_mode(true), _is_initializing(false), _error_strings(false)
+  : _tcp(std::move(tcp)), _ack_mode(true), _is_initializing(false), _error_strings(false),
+    _threads_in_stop_reply(false)
 {
 }
 
@@ -68,6 +70,7 @@ void GDBConnection::read(OnReceiveFn on_receive, OnCloseFn on_close,
 
   _tcp->on<uvw::CloseEvent>([](const auto &event, auto &tcp) {
     auto self = tcp.template data<GDBConnection>();
+    self->_output_compressor.log_stats();
     self->_on_close();
   });
 
@@ -76,18 +79,25 @@ void GDBConnection::read(OnReceiveFn on_receive, OnCloseFn on_close,
   _tcp->template on<uvw::DataEvent>([](const auto &event, auto &tcp) {
     auto self = tcp.template data<GDBConnection>();
 
-    std::vector<char> data(event.data.get(), event.data.get() + event.length);
+    const auto data = event.data.get();
 
-    if (self->_is_initializing && data.size() == 1 && data.front() == '+') {
+    if (self->_is_initializing && event.length == 1 && data[0] == '+') {
       spdlog::get(LOGNAME_CONSOLE)->debug("Got initial ACK.");
       self->_is_initializing = false;
       tcp.write(ACK_OK, 1);
     } else {
-      self->_input_queue.append(std::move(data));
-      while (!self->_input_queue.empty()) {
-        const auto raw_packet = self->_input_queue.pop();
+      self->_input_scanner.feed(data, event.length);
+      while (const auto raw_packet = self->_input_scanner.next()) {
+        if (raw_packet->too_long) {
+          if (self->_ack_mode)
+            tcp.write(ACK_ERROR, 1);
+          spdlog::get(LOGNAME_ERROR)->warn(
+              "Dropped packet longer than {0:d} bytes", GDBPacketScanner::MAX_PACKET_SIZE);
+          continue;
+        }
 
-        bool valid = raw_packet.is_checksum_valid();
+        const auto &contents = raw_packet->contents;
+        bool valid = raw_packet->checksum_valid;
 
         if (self->_ack_mode) {
           tcp.write(valid ? ACK_OK : ACK_ERROR, 1);
@@ -95,23 +105,34 @@ void GDBConnection::read(OnReceiveFn on_receive, OnCloseFn on_close,
         }
 
         if (valid) {
-          try {
-            spdlog::get(LOGNAME_CONSOLE)->debug("RECV: {0}", raw_packet.to_string());
-            const auto packet = parse_packet(raw_packet);
-            self->_on_receive(*self, packet);
-          } catch (const UnknownPacketTypeException &e) {
-            spdlog::get(LOGNAME_ERROR)->warn(
-              "Got packet of unknown type: \"{0}\"", e.what());
-            self->send(rsp::NotSupportedResponse());
-          } catch (const req::RequestPacketParseException &e) {
+          spdlog::get(LOGNAME_CONSOLE)->debug("RECV: {0}", contents);
+
+          const char *error = nullptr;
+          const auto packet = parse_packet(contents, error);
+          if (packet) {
+            // Copied, since contents points into the scanner's buffer. Reset
+            // even if the handler throws, so that later (e.g. async) packets
+            // aren't counted against this one's type.
+            self->_packet_type.assign(get_packet_type(contents));
+            try {
+              self->_on_receive(*self, *packet);
+            } catch (...) {
+              self->_packet_type.clear();
+              throw;
+            }
+            self->_packet_type.clear();
+          } else if (error) {
             spdlog::get(LOGNAME_ERROR)->error(
-                "Failed to parse packet ({0}): \"{1}\"",
-                e.what(), raw_packet.get_contents());
+                "Failed to parse packet ({0}): \"{1}\"", error, contents);
+            self->send(rsp::NotSupportedResponse());
+          } else {
+            spdlog::get(LOGNAME_ERROR)->warn(
+              "Got packet of unknown type: \"{0}\"", contents);
             self->send(rsp::NotSupportedResponse());
           }
         } else {
           spdlog::get(LOGNAME_ERROR)->warn(
-              "Invalid checksum for packet: \"{0}\"", raw_packet.get_contents());
+              "Invalid checksum for packet: \"{0}\"", contents);
         }
       }
     }
@@ -122,12 +143,31 @@ void GDBConnection::read(OnReceiveFn on_receive, OnCloseFn on_close,
 
 void GDBConnection::send(const rsp::GDBResponse &packet)
 {
-  const auto raw_packet = GDBPacket(packet.to_string());
-  const auto &contents = raw_packet.to_string();
+  _output_writer.begin();
+  packet.write(_output_writer);
+  const auto contents = _output_writer.end();
 
   spdlog::get(LOGNAME_CONSOLE)->debug("SEND: {0}", contents);
 
-  _tcp->write((char*)contents.c_str(), contents.size());
+  write(_output_compressor.compress(
+        contents, _output_writer.has_binary(), _packet_type));
+}
+
+// The writer's buffer is reused by the next packet, so whatever libuv can't
+// send right away is copied into a buffer the pending write owns
+void GDBConnection::write(std::string_view data) {
+  auto buf = uv_buf_init(const_cast<char*>(data.data()), data.size());
+  const auto written = uv_try_write(
+      reinterpret_cast<uv_stream_t*>(_tcp->raw()), &buf, 1);
+
+  const auto sent = (written > 0) ? (size_t)written : 0;
+  if (sent == data.size())
+    return;
+
+  const auto remaining = data.size() - sent;
+  auto rest = std::make_unique<char[]>(remaining);
+  std::memcpy(rest.get(), data.data() + sent, remaining);
+  _tcp->write(std::move(rest), remaining);
 }
 
 void GDBConnection::send_error(uint8_t code, std::string message) {
@@ -137,52 +177,114 @@ void GDBConnection::send_error(uint8_t code, std::string message) {
     send(rsp::ErrorResponse(code));
 }
 
-template <typename T>
-static auto make_parser() {
-  return [](const auto &s) { return T(s); };
-}
+namespace {
 
-GDBRequest GDBConnection::parse_packet(const GDBPacket &packet) {
   using namespace xd::gdb::req;
-  using ParseRequestFn = std::function<GDBRequest(const std::string&)>;
-
-  static const std::vector<std::pair<std::string, ParseRequestFn>> request_parsers = {
-      { "qfThreadInfo",             make_parser<QueryThreadInfoStartRequest>() },
-      { "qsThreadInfo",             make_parser<QueryThreadInfoContinuingRequest>() },
-      { "qC",                       make_parser<QueryCurrentThreadIDRequest>() },
-      { "qWatchpointSupportInfo", make_parser<QueryWatchpointSupportInfo>() },
-      { "qSupported",               make_parser<QuerySupportedRequest>() },
-      { "qHostInfo",                make_parser<QueryHostInfoRequest>() },
-      { "qProcessInfo",             make_parser<QueryProcessInfoRequest>() },
-      { "qRegisterInfo",            make_parser<QueryRegisterInfoRequest>() },
-      { "qMemoryRegionInfo",        make_parser<QueryMemoryRegionInfoRequest>() },
-      { "QStartNoAckMode",          make_parser<StartNoAckModeRequest>() },
-      { "QThreadSuffixSupported",   make_parser<QueryThreadSuffixSupportedRequest>() },
-      { "QListThreadsInStopReply",  make_parser<QueryListThreadsInStopReplySupportedRequest>() },
-      { "QEnableErrorStrings",      make_parser<QueryEnableErrorStrings>() },
-      { "\x03",                     make_parser<InterruptRequest>() },
-      { "?",                        make_parser<StopReasonRequest>() },
-      { "k",                        make_parser<KillRequest>() },
-      { "H",                        make_parser<SetThreadRequest>() },
-      { "p",                        make_parser<RegisterReadRequest>() },
-      { "P",                        make_parser<RegisterWriteRequest>() },
-      { "g",                        make_parser<GeneralRegistersBatchReadRequest>() },
-      { "G",                        make_parser<GeneralRegistersBatchWriteRequest>() },
-      { "m",                        make_parser<MemoryReadRequest>() },
-      { "M",                        make_parser<MemoryWriteRequest>() },
-      { "c",                        make_parser<ContinueRequest>() },
-      { "C",                        make_parser<ContinueSignalRequest>() },
-      { "s",                        make_parser<StepRequest>() },
-      { "S",                        make_parser<StepSignalRequest>() },
-      { "z",                        make_parser<BreakpointRemoveRequest>() },
-      { "Z",                        make_parser<BreakpointInsertRequest>() },
-      { "R",                        make_parser<RestartRequest>() },
-      { "D",                        make_parser<DetachRequest>() },
+
+  using ParseFn = std::optional<GDBRequest> (*)(std::string_view, const char *&);
+
+  template <typename Request_t>
+  std::optional<GDBRequest> parse(std::string_view contents, const char *&error) {
+    Request_t request(contents);
+    if (!request.is_valid()) {
+      error = request.get_error();
+      return std::nullopt;
+    }
+    return GDBRequest(std::move(request));
+  }
+
+  struct NamedParser {
+    std::string_view name;
+    ParseFn parse;
   };
 
-  for (const auto &pair : request_parsers)
-    if (packet.starts_with(pair.first))
-      return pair.second(packet.get_contents());
+  // Packets that are identified by a name rather than a single character
+  constexpr std::array<NamedParser, 17> NAMED_PARSERS = {{
+      { "qfThreadInfo",             parse<QueryThreadInfoStartRequest> },
+      { "qsThreadInfo",             parse<QueryThreadInfoContinuingRequest> },
+      { "qC",                       parse<QueryCurrentThreadIDRequest> },
+      { "qWatchpointSupportInfo",   parse<QueryWatchpointSupportInfo> },
+      { "qSupported",               parse<QuerySupportedRequest> },
+      { "qHostInfo",                parse<QueryHostInfoRequest> },
+      { "qProcessInfo",             parse<QueryProcessInfoRequest> },
+      { "qRegisterInfo",            parse<QueryRegisterInfoRequest> },
+      { "qXfer:features:read:",     parse<QueryFeaturesReadRequest> },
+      { "qMemoryRegionInfo",        parse<QueryMemoryRegionInfoRequest> },
+      { "QStartNoAckMode",          parse<StartNoAckModeRequest> },
+      { "QThreadSuffixSupported",   parse<QueryThreadSuffixSupportedRequest> },
+      { "QListThreadsInStopReply",  parse<QueryListThreadsInStopReplySupportedRequest> },
+      { "QEnableErrorStrings",      parse<QueryEnableErrorStrings> },
+      { "QEnableCompression",       parse<QueryEnableCompressionRequest> },
+      { "QSaveRegisterState",       parse<SaveRegisterStateRequest> },
+      { "QRestoreRegisterState",    parse<RestoreRegisterStateRequest> },
+  }};
+
+  template <size_t N>
+  constexpr std::array<std::string_view, N> get_names(
+      const std::array<NamedParser, N> &parsers)
+  {
+    std::array<std::string_view, N> names{};
+    for (size_t i = 0; i < N; ++i)
+      names[i] = parsers[i].name;
+    return names;
+  }
+
+  constexpr auto PARSER_NAMES = get_names(NAMED_PARSERS);
+  constexpr PrefixTrie<trie_size(PARSER_NAMES)> PARSER_TRIE(PARSER_NAMES);
+
+}
+
+std::optional<GDBRequest> GDBConnection::parse_packet(
+    std::string_view contents, const char *&error)
+{
+  if (contents.empty())
+    return std::nullopt;
+
+  switch (contents.front()) {
+    case 'q':
+    case 'Q':
+    case 'v':
+    case 'j':
+      if (const auto index = PARSER_TRIE.find_longest_prefix(contents))
+        return NAMED_PARSERS[*index].parse(contents, error);
+      return std::nullopt;
+    case '\x03': return parse<InterruptRequest>(contents, error);
+    case '?':     return parse<StopReasonRequest>(contents, error);
+    case 'k':     return parse<KillRequest>(contents, error);
+    case 'H':     return parse<SetThreadRequest>(contents, error);
+    case 'p':     return parse<RegisterReadRequest>(contents, error);
+    case 'P':     return parse<RegisterWriteRequest>(contents, error);
+    case 'g':     return parse<GeneralRegistersBatchReadRequest>(contents, error);
+    case 'G':     return parse<GeneralRegistersBatchWriteRequest>(contents, error);
+    case 'm':     return parse<MemoryReadRequest>(contents, error);
+    case 'M':     return parse<MemoryWriteRequest>(contents, error);
+    case 'x':     return parse<MemoryReadBinaryRequest>(contents, error);
+    case 'X':     return parse<MemoryWriteBinaryRequest>(contents, error);
+    case 'c':     return parse<ContinueRequest>(contents, error);
+    case 'C':     return parse<ContinueSignalRequest>(contents, error);
+    case 's':     return parse<StepRequest>(contents, error);
+    case 'S':     return parse<StepSignalRequest>(contents, error);
+    case 'z':     return parse<BreakpointRemoveRequest>(contents, error);
+    case 'Z':     return parse<BreakpointInsertRequest>(contents, error);
+    case 'R':     return parse<RestartRequest>(contents, error);
+    case 'D':     return parse<DetachRequest>(contents, error);
+    default:      return std::nullopt;
+  }
+}
+
+std::string_view GDBConnection::get_packet_type(std::string_view contents) {
+  if (contents.empty())
+    return contents;
 
-  throw UnknownPacketTypeException(packet.get_contents());
+  switch (contents.front()) {
+    case 'q':
+    case 'Q':
+    case 'v':
+    case 'j':
+      if (const auto index = PARSER_TRIE.find_longest_prefix(contents))
+        return NAMED_PARSERS[*index].name;
+      [[fallthrough]];
+    default:
+      return contents.substr(0, 1);
+  }
 }
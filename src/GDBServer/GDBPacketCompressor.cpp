@@ -0,0 +1,153 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <charconv>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include <Globals.hpp>
+#include <GDBServer/GDBPacketCompressor.hpp>
+
+using xd::gdb::GDBPacketCompressor;
+
+// Same default as debugserver; smaller packets rarely gain anything
+static constexpr size_t DEFAULT_MIN_SIZE = 384;
+
+// Framing around the payload: '$', '#' and two checksum digits
+static constexpr size_t FRAMING_SIZE = 4;
+
+GDBPacketCompressor::GDBPacketCompressor()
+  : _type(Type::None), _min_size(DEFAULT_MIN_SIZE), _zstream()
+{
+  // Raw deflate (negative window bits), without a zlib header, is what
+  // LLDB inflates
+  if (deflateInit2(&_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+        Z_DEFAULT_STRATEGY) != Z_OK)
+    throw std::runtime_error("Failed to initialize zlib!");
+}
+
+GDBPacketCompressor::~GDBPacketCompressor() {
+  deflateEnd(&_zstream);
+}
+
+void GDBPacketCompressor::enable(Type type, std::optional<size_t> min_size) {
+  _type = type;
+  if (min_size)
+    _min_size = *min_size;
+}
+
+std::string_view GDBPacketCompressor::compress(std::string_view packet,
+    bool has_binary, std::string_view packet_type)
+{
+  using Clock = std::chrono::steady_clock;
+
+  const auto payload = packet.substr(1, packet.size() - FRAMING_SIZE);
+  const bool is_small = payload.size() < _min_size;
+
+  // Before negotiation small packets go out as they are. So does anything
+  // with a '*' in it, be it binary data or text such as error messages and
+  // qXfer documents: the client would read it as the start of a run.
+  if (_type == Type::None &&
+      (is_small || has_binary || payload.find('*') != std::string_view::npos))
+  {
+    return packet;
+  }
+
+  // Once compression is negotiated, small packets are framed with 'N' and
+  // counted too, so that the stats cover all of the traffic
+  const auto start = Clock::now();
+  const auto compressed = is_small
+    ? uncompressed_packet(payload)
+    : (_type == Type::ZlibDeflate)
+      ? deflate_packet(payload)
+      : run_length_packet(payload);
+  const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start);
+
+  const auto key = packet_type.empty() ? std::string_view("async") : packet_type;
+  auto it = _stats.find(key);
+  if (it == _stats.end())
+    it = _stats.emplace(std::string(key), Stats()).first;
+
+  auto &stats = it->second;
+  stats.packets += 1;
+  stats.raw_bytes += packet.size();
+  stats.sent_bytes += compressed.size();
+  stats.time += time;
+
+  spdlog::get(LOGNAME_CONSOLE)->debug(
+      "Compressed {0} response: {1:d} -> {2:d} bytes ({3:.1f}%) in {4:d} ns",
+      key, packet.size(), compressed.size(),
+      100.0 * compressed.size() / packet.size(), time.count());
+
+  return compressed;
+}
+
+void GDBPacketCompressor::log_stats() const {
+  for (const auto &[type, stats] : _stats) {
+    spdlog::get(LOGNAME_CONSOLE)->info(
+        "Compression of {0} responses: {1:d} packets, {2:d} -> {3:d} bytes "
+        "({4:.1f}%), {5:d} ns per packet",
+        type, stats.packets, stats.raw_bytes, stats.sent_bytes,
+        100.0 * stats.sent_bytes / stats.raw_bytes,
+        stats.time.count() / stats.packets);
+  }
+}
+
+std::string_view GDBPacketCompressor::deflate_packet(std::string_view payload) {
+  deflateReset(&_zstream);
+  _deflated.resize(deflateBound(&_zstream, payload.size()));
+
+  _zstream.next_in = (Bytef*)payload.data();
+  _zstream.avail_in = payload.size();
+  _zstream.next_out = _deflated.data();
+  _zstream.avail_out = _deflated.size();
+
+  if (deflate(&_zstream, Z_FINISH) != Z_STREAM_END ||
+      _zstream.total_out >= payload.size())
+  {
+    return uncompressed_packet(payload);
+  }
+
+  char size[24];
+  const auto size_end = std::to_chars(size, size + sizeof(size), payload.size()).ptr;
+
+  _writer.begin();
+  _writer.write('C');
+  _writer.write(std::string_view(size, size_end - size));
+  _writer.write(':');
+  _writer.write_binary(_deflated.data(), _zstream.total_out);
+  return _writer.end();
+}
+
+std::string_view GDBPacketCompressor::uncompressed_packet(std::string_view payload) {
+  _writer.begin();
+  _writer.write('N');
+  _writer.write(payload);
+  return _writer.end();
+}
+
+std::string_view GDBPacketCompressor::run_length_packet(std::string_view payload) {
+  _writer.begin();
+  _writer.write_run_length(payload);
+  return _writer.end();
+}
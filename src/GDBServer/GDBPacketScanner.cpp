@@ -0,0 +1,143 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <GDBServer/GDBPacketScanner.hpp>
+#include <Util/hex.hpp>
+
+using xd::gdb::GDBPacketScanner;
+
+static constexpr size_t INITIAL_BUFFER_SIZE = 0x1000;
+
+GDBPacketScanner::GDBPacketScanner()
+  : _buffer(INITIAL_BUFFER_SIZE), _begin(0), _scan(0), _end(0),
+    _state(State::Idle), _packet_start(0), _packet_end(0),
+    _sum(0), _checksum(0), _checksum_malformed(false), _discarding(false)
+{
+}
+
+void GDBPacketScanner::feed(const char *data, size_t length) {
+  make_room(length);
+  std::memcpy(_buffer.data() + _end, data, length);
+  _end += length;
+}
+
+void GDBPacketScanner::make_room(size_t length) {
+  if (_buffer.size() - _end >= length)
+    return;
+
+  // Only the unconsumed tail (at most one partial packet) is moved, and only
+  // when the free space at the back runs out
+  if (_begin) {
+    std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+    _scan -= _begin;
+    _packet_start -= std::min(_packet_start, _begin);
+    _packet_end -= std::min(_packet_end, _begin);
+    _end -= _begin;
+    _begin = 0;
+  }
+
+  auto size = _buffer.size();
+  while (size - _end < length)
+    size *= 2;
+  _buffer.resize(size);
+}
+
+std::optional<GDBPacketScanner::Packet> GDBPacketScanner::next() {
+  const auto buffer = _buffer.data();
+
+  while (_scan < _end) {
+    const auto c = buffer[_scan++];
+
+    switch (_state) {
+      /*
+       * For some ungodly reason, GDB sends interrupt requests as a raw 0x03
+       * byte, not encapsulated in a packet. As such, we have to check the
+       * intermediate space between packets for 0x03s and interpret them as
+       * interrupts. Anything else there (e.g. stray ACKs) is dropped.
+       */
+      case State::Idle:
+        if (c == '$') {
+          _state = State::Body;
+          _packet_start = _scan;
+          _sum = 0;
+        } else {
+          _begin = _scan;
+          if (c == '\x03')
+            return Packet{ std::string_view(buffer + _scan - 1, 1), true, false };
+        }
+        break;
+      case State::Body:
+        if (c == '#') {
+          _state = State::ChecksumHigh;
+          _packet_end = _scan - 1;
+        } else if (_scan - _packet_start > MAX_PACKET_SIZE) {
+          // Stop buffering it; the rest is skipped up to its checksum
+          _state = State::Discard;
+          _begin = _scan;
+          return Packet{ std::string_view(), false, true };
+        } else {
+          _sum += c;
+        }
+        break;
+      case State::Discard:
+        if (c == '#') {
+          _state = State::ChecksumHigh;
+          _discarding = true;
+        }
+        _begin = _scan;
+        break;
+      case State::ChecksumHigh: {
+        const auto nibble = xd::util::hex::digit_value(c);
+        _checksum_malformed = (nibble < 0);
+        _checksum = (uint8_t)((nibble & 0xf) << 4);
+        _state = State::ChecksumLow;
+        break;
+      }
+      case State::ChecksumLow: {
+        const auto nibble = xd::util::hex::digit_value(c);
+        _checksum_malformed |= (nibble < 0);
+        _checksum |= (nibble & 0xf);
+        _state = State::Idle;
+        _begin = _scan;
+
+        if (_discarding) {
+          _discarding = false;
+          break;
+        }
+
+        return Packet{
+          std::string_view(buffer + _packet_start, _packet_end - _packet_start),
+          !_checksum_malformed && _checksum == _sum,
+          false
+        };
+      }
+    }
+  }
+
+  // Everything has been consumed, so new data can go back at the front
+  if (_begin == _end)
+    _begin = _scan = _end = 0;
+
+  return std::nullopt;
+}
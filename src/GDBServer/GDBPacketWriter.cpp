@@ -0,0 +1,128 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <GDBServer/GDBPacketWriter.hpp>
+#include <Util/hex.hpp>
+
+using xd::gdb::GDBPacketWriter;
+
+static constexpr size_t INITIAL_BUFFER_SIZE = 0x1000;
+
+GDBPacketWriter::GDBPacketWriter()
+  : _checksum(0), _has_binary(false)
+{
+  _buffer.reserve(INITIAL_BUFFER_SIZE);
+}
+
+void GDBPacketWriter::begin() {
+  _buffer.clear();
+  _buffer.push_back('$');
+  _checksum = 0;
+  _has_binary = false;
+}
+
+std::string_view GDBPacketWriter::end() {
+  const auto checksum = _checksum;
+  _buffer.push_back('#');
+  util::hex::encode(&checksum, 1, grow(2));
+  return std::string_view(_buffer.data(), _buffer.size());
+}
+
+void GDBPacketWriter::write(char c) {
+  _buffer.push_back(c);
+  _checksum += c;
+}
+
+void GDBPacketWriter::write(std::string_view s) {
+  std::memcpy(grow(s.size()), s.data(), s.size());
+  for (const auto c : s)
+    _checksum += c;
+}
+
+void GDBPacketWriter::write_hex(const void *data, size_t length) {
+  _checksum += util::hex::encode(data, length, grow(2*length));
+}
+
+// '#', '$', '}' and '*' are escaped as '}' followed by the byte XOR 0x20;
+// everything else goes out as is
+void GDBPacketWriter::write_binary(const void *data, size_t length) {
+  const auto bytes = (const char*)data;
+  auto out = grow(2*length);
+  _has_binary = true;
+
+  for (size_t i = 0; i < length; ++i) {
+    auto c = bytes[i];
+    if (c == '#' || c == '$' || c == '}' || c == '*') {
+      *out++ = '}';
+      _checksum += '}';
+      c ^= 0x20;
+    }
+    *out++ = c;
+    _checksum += c;
+  }
+
+  _buffer.resize(out - _buffer.data());
+}
+
+/*
+ * A run is sent as the character, then '*' and the number of further
+ * repeats offset by 29. The count must stay printable and must not produce
+ * '#' or '$', which caps it at 97 and rules out 6 and 7. Longer runs are
+ * split, each piece restating the character; runs too short to gain
+ * anything are sent as is.
+ */
+void GDBPacketWriter::write_run_length(std::string_view s) {
+  static constexpr size_t MAX_REPEATS = 126 - 29;
+
+  for (size_t i = 0; i < s.size();) {
+    const auto c = s[i];
+    size_t remaining = 1;
+    while (i + remaining < s.size() && s[i + remaining] == c)
+      ++remaining;
+    i += remaining;
+
+    while (remaining) {
+      write(c);
+      --remaining;
+
+      auto n = std::min(remaining, MAX_REPEATS);
+      if (n == 6 || n == 7)
+        n = 5;
+      if (n < 3)
+        continue;
+
+      write('*');
+      write((char)(n + 29));
+      remaining -= n;
+    }
+  }
+}
+
+// Capacity is kept across packets, so this only allocates when a packet is
+// bigger than any sent before
+char *GDBPacketWriter::grow(size_t length) {
+  const auto size = _buffer.size();
+  _buffer.resize(size + length);
+  return _buffer.data() + size;
+}
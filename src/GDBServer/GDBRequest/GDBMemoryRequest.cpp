@@ -19,20 +19,25 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <GDBServer/GDBPacketScanner.hpp>
 #include <GDBServer/GDBRequest/GDBMemoryRequest.hpp>
 
 using namespace xd::gdb::req;
 
-MemoryReadRequest::MemoryReadRequest(const std::string &data)
+MemoryReadRequest::MemoryReadRequest(std::string_view data)
   : GDBRequestBase(data, 'm')
 {
   _address = read_hex_number<uint64_t>();
   expect_char(',');
   _length = read_hex_number<uint64_t>();
   expect_end();
+
+  // Don't let the client size the reply buffer arbitrarily
+  if (_length > GDBPacketScanner::MAX_PACKET_SIZE)
+    fail("Memory read length too large");
 };
 
-MemoryWriteRequest::MemoryWriteRequest(const std::string &data)
+MemoryWriteRequest::MemoryWriteRequest(std::string_view data)
   : GDBRequestBase(data, 'M')
 {
   _address = read_hex_number<uint64_t>();
@@ -40,9 +45,50 @@ MemoryWriteRequest::MemoryWriteRequest(const std::string &data)
   _length = read_hex_number<uint64_t>();
   expect_char(':');
 
-  _data.reserve(_length);
-  for (size_t i = 0; i < _length; ++i)
-    _data.push_back(read_byte());
+  // Check the length against the payload before trusting it with a resize;
+  // doubling _length instead could wrap and let a bogus length through
+  const auto remaining = get_num_remaining();
+  if (remaining % 2 || _length != remaining / 2) {
+    fail("Memory write length mismatch");
+    return;
+  }
+
+  _data.resize(_length);
+  read_hex_bytes(_data.data(), _length);
+
+  expect_end();
+};
+
+MemoryReadBinaryRequest::MemoryReadBinaryRequest(std::string_view data)
+  : GDBRequestBase(data, 'x')
+{
+  _address = read_hex_number<uint64_t>();
+  expect_char(',');
+  _length = read_hex_number<uint64_t>();
+  expect_end();
+
+  // Don't let the client size the reply buffer arbitrarily
+  if (_length > GDBPacketScanner::MAX_PACKET_SIZE)
+    fail("Memory read length too large");
+};
+
+MemoryWriteBinaryRequest::MemoryWriteBinaryRequest(std::string_view data)
+  : GDBRequestBase(data, 'X')
+{
+  _address = read_hex_number<uint64_t>();
+  expect_char(',');
+  _length = read_hex_number<uint64_t>();
+  expect_char(':');
+
+  // Escaping at most doubles the payload
+  const auto remaining = get_num_remaining();
+  if (remaining < _length || remaining > 2*_length) {
+    fail("Memory write length mismatch");
+    return;
+  }
+
+  _data.resize(_length);
+  read_escaped_bytes(_data.data(), _length);
 
   expect_end();
 };
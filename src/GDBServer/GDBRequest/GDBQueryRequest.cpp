@@ -23,14 +23,32 @@
 
 using namespace xd::gdb::req;
 
-QueryWatchpointSupportInfo::QueryWatchpointSupportInfo(const std::string &data)
+QueryEnableCompressionRequest::QueryEnableCompressionRequest(std::string_view data)
+  : GDBRequestBase(data, "QEnableCompression")
+{
+  expect_char(':');
+  while (has_more()) {
+    if (check_string("type:")) {
+      _type = read_until_char_or_end(';');
+    } else if (check_string("minsize:")) {
+      _min_size = read_dec_number<size_t>();
+      expect_char(';');
+    } else {
+      read_until_char_or_end(';'); // Unknown; ignore
+    }
+  }
+  if (_type.empty())
+    fail("Missing compression type");
+};
+
+QueryWatchpointSupportInfo::QueryWatchpointSupportInfo(std::string_view data)
   : GDBRequestBase(data, "qWatchpointSupportInfo")
 {
   check_char(':');
   expect_end();
 };
 
-QuerySupportedRequest::QuerySupportedRequest(const std::string &data)
+QuerySupportedRequest::QuerySupportedRequest(std::string_view data)
   : GDBRequestBase(data, "qSupported")
 {
   expect_char(':');
@@ -41,14 +59,24 @@ QuerySupportedRequest::QuerySupportedRequest(const std::string &data)
   expect_end();
 };
 
-QueryRegisterInfoRequest::QueryRegisterInfoRequest(const std::string &data)
+QueryRegisterInfoRequest::QueryRegisterInfoRequest(std::string_view data)
   : GDBRequestBase(data, "qRegisterInfo")
 {
   _register_id = read_hex_number<uint16_t>();
   expect_end();
 };
 
-QueryMemoryRegionInfoRequest::QueryMemoryRegionInfoRequest(const std::string &data)
+QueryFeaturesReadRequest::QueryFeaturesReadRequest(std::string_view data)
+  : GDBRequestBase(data, "qXfer:features:read:")
+{
+  _annex = read_until_char_or_end(':');
+  _offset = read_hex_number<size_t>();
+  expect_char(',');
+  _length = read_hex_number<size_t>();
+  expect_end();
+};
+
+QueryMemoryRegionInfoRequest::QueryMemoryRegionInfoRequest(std::string_view data)
   : GDBRequestBase(data, "qMemoryRegionInfo")
 {
   expect_char(':');
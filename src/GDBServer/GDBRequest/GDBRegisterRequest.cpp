@@ -19,11 +19,14 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <cctype>
+
 #include <GDBServer/GDBRequest/GDBRegisterRequest.hpp>
+#include <Registers/RegisterCodec.hpp>
 
 using namespace xd::gdb::req;
 
-GeneralRegistersBatchReadRequest::GeneralRegistersBatchReadRequest(const std::string &data)
+GeneralRegistersBatchReadRequest::GeneralRegistersBatchReadRequest(std::string_view data)
   : GDBRequestBase(data, 'g')
 {
   if (check_char(';')) {
@@ -36,7 +39,7 @@ GeneralRegistersBatchReadRequest::GeneralRegistersBatchReadRequest(const std::st
   expect_end();
 };
 
-RegisterReadRequest::RegisterReadRequest(const std::string &data)
+RegisterReadRequest::RegisterReadRequest(std::string_view data)
   : GDBRequestBase(data, 'p')
 {
   _register_id = read_hex_number<uint16_t>();
@@ -50,45 +53,90 @@ RegisterReadRequest::RegisterReadRequest(const std::string &data)
   expect_end();
 };
 
-RegisterWriteRequest::RegisterWriteRequest(const std::string &data)
+RegisterWriteRequest::RegisterWriteRequest(std::string_view data)
   : GDBRequestBase(data, 'P')
 {
   _register_id = read_hex_number<uint16_t>();
   expect_char('=');
-  _value = read_hex_number_respecting_endianness<uint64_t>();
+  _value_hex = read_until_char_or_end(';');
+
+  if (_value_hex.empty() || _value_hex.size() % 2) {
+    fail("Invalid register value size");
+    return;
+  }
+
+  for (const auto c : _value_hex) {
+    if (!std::isxdigit(c) && c != 'x') {
+      fail("Invalid register value data");
+      return;
+    }
+  }
+
+  if (has_more()) {
+    expect_string("thread:");
+    _thread_id = read_hex_number<size_t>();
+    check_char(';');
+  } else {
+    _thread_id = (size_t)-1;
+  }
+  expect_end();
+};
+
+GeneralRegistersBatchWriteRequest::GeneralRegistersBatchWriteRequest(std::string_view data)
+  : GDBRequestBase(data, 'G')
+{
+  using Codec64 = xd::reg::RegisterCodec<xd::reg::x86_64::RegistersX86_64Target>;
+  using Codec32 = xd::reg::RegisterCodec<xd::reg::x86_32::RegistersX86_32Target>;
+
+  _registers_hex = read_until_char_or_end(';');
+
+  const auto size = _registers_hex.size();
+  if (size != Codec64::hex_size && size != Codec32::hex_size) {
+    fail("Invalid register packet size");
+    return;
+  }
+
+  for (const auto c : _registers_hex) {
+    if (!std::isxdigit(c) && c != 'x') {
+      fail("Invalid register packet data");
+      return;
+    }
+  }
+
+  if (has_more()) {
+    expect_string("thread:");
+    _thread_id = read_hex_number<size_t>();
+    check_char(';');
+  } else {
+    _thread_id = (size_t)-1;
+  }
+  expect_end();
+};
+
+SaveRegisterStateRequest::SaveRegisterStateRequest(std::string_view data)
+  : GDBRequestBase(data, "QSaveRegisterState")
+{
   if (check_char(';')) {
     expect_string("thread:");
     _thread_id = read_hex_number<size_t>();
-    expect_char(';');
+    check_char(';');
+  } else {
+    _thread_id = (size_t)-1;
   }
   expect_end();
 };
 
-GeneralRegistersBatchWriteRequest::GeneralRegistersBatchWriteRequest(const std::string &data)
-  : GDBRequestBase(data, 'g')
+RestoreRegisterStateRequest::RestoreRegisterStateRequest(std::string_view data)
+  : GDBRequestBase(data, "QRestoreRegisterState")
 {
-  using Regs64 = xd::reg::x86_64::RegistersX86_64;
-  using Regs32 = xd::reg::x86_32::RegistersX86_32;
-
-  size_t index = 0;
-  const auto size = get_num_remaining()/2;
-
-  if (size == Regs64::size) {
-    Regs64::for_each_metadata([this, &index](const auto md) {
-      const auto word = read_word(md);
-      if (word)
-        _values.push_back(std::make_pair(index, *word));
-      ++index;
-    });
-  } else if (size == Regs32::size) {
-    Regs32::for_each_metadata([this, &index](const auto md) {
-      const auto word = read_word(md);
-      if (word)
-        _values.push_back(std::make_pair(index, *word));
-      ++index;
-    });
+  expect_char(':');
+  _save_id = read_dec_number<size_t>();
+  if (check_char(';')) {
+    expect_string("thread:");
+    _thread_id = read_hex_number<size_t>();
+    check_char(';');
   } else {
-    throw RequestPacketParseException("Invalid register packet size");
+    _thread_id = (size_t)-1;
   }
   expect_end();
 };
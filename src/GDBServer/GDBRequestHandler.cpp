@@ -23,6 +23,207 @@
 
 using xd::gdb::GDBRequestHandler;
 
+namespace {
+  // The registers in 'g' packets: the general purpose ones, the control
+  // registers and EFER, then x87, SSE and AVX. Apart from the control
+  // registers, which GDB has no standard feature for, these match GDB's
+  // org.gnu.gdb.i386.{core,sse,avx} features.
+  template <typename Target_t, typename GPRs_t, typename X87_t, typename SSE_t>
+  struct TargetRegisters {
+    using Target = Target_t;
+    // cr0, cr3, cr4 and msr_efer close the general purpose set
+    static constexpr size_t control_count = 4;
+    static constexpr size_t gpr_count = GPRs_t::count - control_count;
+    static constexpr size_t control_end = GPRs_t::count;
+    static constexpr size_t core_count = control_end + X87_t::count;
+    static constexpr size_t sse_end = core_count + SSE_t::count;
+  };
+
+  struct TargetRegistersX86_64 : public TargetRegisters<
+      xd::reg::x86_64::RegistersX86_64Target, xd::reg::x86_64::RegistersX86_64,
+      xd::reg::x86_64::RegistersX86_64X87, xd::reg::x86_64::RegistersX86_64SSE>
+  {
+    static constexpr auto architecture = "i386:x86-64";
+    // GDB builds ymmN from xmmN and ymmNh itself; LLDB is told to
+    static constexpr size_t ymm_count = 16;
+  };
+
+  struct TargetRegistersX86_32 : public TargetRegisters<
+      xd::reg::x86_32::RegistersX86_32Target, xd::reg::x86_32::RegistersX86_32,
+      xd::reg::x86_32::RegistersX86_32X87, xd::reg::x86_32::RegistersX86_32SSE>
+  {
+    static constexpr auto architecture = "i386";
+    static constexpr size_t ymm_count = 0;
+  };
+
+  struct RegisterDescription {
+    const char *set;
+    const char *encoding;
+    const char *format;
+    const char *feature;
+    const char *group;
+    const char *type;
+  };
+
+  const char *get_int_type(size_t width) {
+    switch (width) {
+      case 1: return "int8";
+      case 2: return "int16";
+      case 4: return "int32";
+      default: return "int64";
+    }
+  }
+
+  constexpr auto CONTROL_FEATURE = "org.xendbg.x86.control";
+
+  // x87 and vector registers are shown as byte vectors. The types are those
+  // of GDB's own descriptions of the same features.
+  template <typename Registers_t, typename Metadata_t>
+  RegisterDescription describe_register(const Metadata_t &md) {
+    if (md.id < Registers_t::gpr_count) {
+      const std::string_view name = md.name;
+      const auto type =
+        (name == "rip" || name == "eip") ? "code_ptr" :
+        (name == "rsp" || name == "esp" || name == "rbp" || name == "ebp") ? "data_ptr" :
+        (name == "rflags" || name == "eflags") ? "i386_eflags" :
+        get_int_type(md.width);
+      return { "General Purpose Registers", "uint", "hex",
+        "org.gnu.gdb.i386.core", "general", type };
+    }
+    if (md.id < Registers_t::control_end) {
+      return { "System Registers", "uint", "hex",
+        CONTROL_FEATURE, "system", get_int_type(md.width) };
+    }
+    if (md.id < Registers_t::core_count) {
+      if (md.width == sizeof(xd::reg::x86::Float80))
+        return { "Floating Point Registers", "vector", "vector-uint8",
+          "org.gnu.gdb.i386.core", "float", "i387_ext" };
+      return { "Floating Point Registers", "uint", "hex",
+        "org.gnu.gdb.i386.core", "float", get_int_type(md.width) };
+    }
+    if (md.id < Registers_t::sse_end) {
+      if (md.width == sizeof(xd::reg::x86::Vector128))
+        return { "Floating Point Registers", "vector", "vector-uint8",
+          "org.gnu.gdb.i386.sse", "vector", "vec128" };
+      return { "Floating Point Registers", "uint", "hex",
+        "org.gnu.gdb.i386.sse", "vector", get_int_type(md.width) };
+    }
+    return { "Advanced Vector Extensions", "vector", "vector-uint8",
+      "org.gnu.gdb.i386.avx", "vector", "uint128" };
+  }
+
+  // As in GDB's 64bit-core.xml
+  constexpr auto EFLAGS_TYPE =
+    "<flags id=\"i386_eflags\" size=\"4\">"
+      "<field name=\"CF\" start=\"0\" end=\"0\"/>"
+      "<field name=\"\" start=\"1\" end=\"1\"/>"
+      "<field name=\"PF\" start=\"2\" end=\"2\"/>"
+      "<field name=\"AF\" start=\"4\" end=\"4\"/>"
+      "<field name=\"ZF\" start=\"6\" end=\"6\"/>"
+      "<field name=\"SF\" start=\"7\" end=\"7\"/>"
+      "<field name=\"TF\" start=\"8\" end=\"8\"/>"
+      "<field name=\"IF\" start=\"9\" end=\"9\"/>"
+      "<field name=\"DF\" start=\"10\" end=\"10\"/>"
+      "<field name=\"OF\" start=\"11\" end=\"11\"/>"
+      "<field name=\"NT\" start=\"14\" end=\"14\"/>"
+      "<field name=\"RF\" start=\"16\" end=\"16\"/>"
+      "<field name=\"VM\" start=\"17\" end=\"17\"/>"
+      "<field name=\"AC\" start=\"18\" end=\"18\"/>"
+      "<field name=\"VIF\" start=\"19\" end=\"19\"/>"
+      "<field name=\"VIP\" start=\"20\" end=\"20\"/>"
+      "<field name=\"ID\" start=\"21\" end=\"21\"/>"
+    "</flags>";
+
+  // As in GDB's 64bit-sse.xml; none of these are built in
+  constexpr auto VEC128_TYPES =
+    "<vector id=\"v4f\" type=\"ieee_single\" count=\"4\"/>"
+    "<vector id=\"v2d\" type=\"ieee_double\" count=\"2\"/>"
+    "<vector id=\"v16i8\" type=\"int8\" count=\"16\"/>"
+    "<vector id=\"v8i16\" type=\"int16\" count=\"8\"/>"
+    "<vector id=\"v4i32\" type=\"int32\" count=\"4\"/>"
+    "<vector id=\"v2i64\" type=\"int64\" count=\"2\"/>"
+    "<union id=\"vec128\">"
+      "<field name=\"v4_float\" type=\"v4f\"/>"
+      "<field name=\"v2_double\" type=\"v2d\"/>"
+      "<field name=\"v16_int8\" type=\"v16i8\"/>"
+      "<field name=\"v8_int16\" type=\"v8i16\"/>"
+      "<field name=\"v4_int32\" type=\"v4i32\"/>"
+      "<field name=\"v2_int64\" type=\"v2i64\"/>"
+      "<field name=\"uint128\" type=\"uint128\"/>"
+    "</union>";
+
+  // Built once per register set, and sent in chunks by qXfer:features:read.
+  // The control registers sit between the two halves of the core feature
+  // in 'g' packets, so each feature is gathered on its own; clients place
+  // registers by regnum and offset, not by their order here.
+  template <typename Registers_t>
+  const std::string &get_target_xml() {
+    static const auto xml = []() {
+      std::stringstream ss;
+      ss << "<?xml version=\"1.0\"?>"
+         << "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+         << "<target version=\"1.0\">"
+         << "<architecture>" << Registers_t::architecture << "</architecture>";
+
+      const std::string_view features[] = {
+        "org.gnu.gdb.i386.core", CONTROL_FEATURE,
+        "org.gnu.gdb.i386.sse", "org.gnu.gdb.i386.avx",
+      };
+
+      for (const auto feature : features) {
+        bool is_open = false;
+        Registers_t::Target::for_each_metadata([&](const auto &md) {
+          const auto desc = describe_register<Registers_t>(md);
+          if (feature != desc.feature)
+            return;
+
+          if (!is_open) {
+            is_open = true;
+            ss << "<feature name=\"" << feature << "\">";
+            if (feature == "org.gnu.gdb.i386.core")
+              ss << EFLAGS_TYPE;
+            else if (feature == "org.gnu.gdb.i386.sse")
+              ss << VEC128_TYPES;
+          }
+
+          ss << "<reg name=\"" << (md.alt_name ? md.alt_name : md.name) << "\""
+             << " bitsize=\"" << 8*md.width << "\""
+             << " offset=\"" << md.offset << "\""
+             << " regnum=\"" << md.id << "\""
+             << " type=\"" << desc.type << "\""
+             << " group=\"" << desc.group << "\""
+             << " encoding=\"" << desc.encoding << "\""
+             << " format=\"" << desc.format << "\"";
+          if (md.gcc_id != (size_t)-1) {
+            ss << " ehframe_regnum=\"" << md.gcc_id << "\""
+               << " dwarf_regnum=\"" << md.gcc_id << "\"";
+          }
+          ss << "/>";
+        });
+
+        if (is_open)
+          ss << "</feature>";
+      }
+
+      ss << "</target>";
+      return ss.str();
+    }();
+    return xml;
+  }
+}
+
+template <typename F>
+void GDBRequestHandler::visit_target_registers(F f) const {
+  const auto word_size = _debugger.get_domain().get_word_size();
+
+  if (word_size == sizeof(uint64_t))
+    f(TargetRegistersX86_64{});
+  else if (word_size == sizeof(uint32_t))
+    f(TargetRegistersX86_32{});
+  else
+    throw WordSizeException(word_size);
+}
+
 std::vector<size_t> GDBRequestHandler::get_thread_ids() const {
   const auto max_vcpu_id = _debugger.get_domain().get_dominfo().max_vcpu_id;
   std::vector<size_t> thread_ids;
@@ -31,12 +232,29 @@ std::vector<size_t> GDBRequestHandler::get_thread_ids() const {
   return thread_ids;
 }
 
+xd::xen::VCPU_ID GDBRequestHandler::get_vcpu_id(size_t thread_id) const {
+  return (thread_id == (size_t)-1) ? _debugger.get_vcpu_id() : thread_id-1;
+}
+
+std::vector<uint64_t> GDBRequestHandler::get_thread_pcs() const {
+  // Reading every VCPU's context on every stop is only worth it for clients
+  // that asked for the PCs to be listed
+  std::vector<uint64_t> thread_pcs;
+  if (!_connection.is_threads_in_stop_reply_enabled())
+    return thread_pcs;
+
+  // One snapshot of all VCPUs, rather than a context fetch per thread
+  for (const auto &regs : _debugger.get_domain().get_cpu_contexts())
+    thread_pcs.push_back(reg::read_register<reg::x86_32::eip, reg::x86_64::rip>(regs));
+  return thread_pcs;
+}
+
 template <>
 void GDBRequestHandler::operator()(
     const req::InterruptRequest &) const
 {
   _debugger.get_domain().pause();
-  send(rsp::StopReasonSignalResponse(SIGSTOP, 1, get_thread_ids()));
+  send(rsp::StopReasonSignalResponse(SIGSTOP, 1, get_thread_ids(), get_thread_pcs()));
 }
 
 template <>
@@ -58,10 +276,16 @@ template <>
 void GDBRequestHandler::operator()(
     const req::QuerySupportedRequest &) const
 {
+  std::stringstream packet_size;
+  packet_size << "PacketSize=" << std::hex << GDBPacketScanner::MAX_PACKET_SIZE;
+
   send(rsp::QuerySupportedResponse({
-    "PacketSize=20000",
+    packet_size.str(),
     "QStartNoAckMode+",
     "QThreadSuffixSupported+",
+    "qXfer:features:read+",
+    "binary-upload+",
+    "SupportedCompressions=zlib-deflate",
     "QListThreadsInStopReplySupported+",
   }));
 }
@@ -73,6 +297,21 @@ void GDBRequestHandler::operator()(
   send(rsp::OKResponse());
 }
 
+template <>
+void GDBRequestHandler::operator()(
+    const req::QueryEnableCompressionRequest &req) const
+{
+  if (req.get_type() != "zlib-deflate") {
+    send_error(0x45, "Unsupported compression type");
+    return;
+  }
+
+  // The OK itself still goes out uncompressed
+  send(rsp::OKResponse());
+  _connection.enable_compression(
+      GDBPacketCompressor::Type::ZlibDeflate, req.get_min_size());
+}
+
 template <>
 void GDBRequestHandler::operator()(
     const req::QueryThreadSuffixSupportedRequest &) const
@@ -84,6 +323,7 @@ template <>
 void GDBRequestHandler::operator()(
     const req::QueryListThreadsInStopReplySupportedRequest &) const
 {
+  _connection.enable_threads_in_stop_reply();
   send(rsp::OKResponse());
 }
 
@@ -100,27 +340,46 @@ void GDBRequestHandler::operator()(
     const req::QueryRegisterInfoRequest &req) const
 {
   const auto id = req.get_register_id();
-  const auto word_size = _debugger.get_domain().get_word_size();
 
-  if (word_size == sizeof(uint64_t)) {
-    reg::x86_64::RegistersX86_64::find_metadata_by_id(id,
+  visit_target_registers([&](auto registers) {
+    using Registers = decltype(registers);
+    Registers::Target::find_metadata_by_id(id,
       [&](const auto &md) {
+        const auto desc = describe_register<Registers>(md);
         send(rsp::QueryRegisterInfoResponse(
-            md.name, 8*md.width, md.offset, md.gcc_id));
+            md.name, 8*md.width, md.offset, md.gcc_id,
+            desc.set, desc.encoding, desc.format));
       }, [&]() {
-        send_error(0x45);
-      });
-  } else if (word_size == sizeof(uint32_t)) {
-    reg::x86_32::RegistersX86_32::find_metadata_by_id(id,
-      [&](const auto &md) {
+        // Past the real registers come the full YMM registers, which LLDB
+        // reads as the concatenation of their XMM and upper halves
+        const auto n = id - Registers::Target::count;
+        if (id < Registers::Target::count || n >= Registers::ymm_count) {
+          send_error(0x45);
+          return;
+        }
         send(rsp::QueryRegisterInfoResponse(
-            md.name, 8*md.width, md.offset, md.gcc_id));
-      }, [&]() {
-        send_error(0x45);
+            "ymm" + std::to_string(n), 256, (size_t)-1, (size_t)-1,
+            "Advanced Vector Extensions", "vector", "vector-uint8",
+            { Registers::core_count + n, Registers::sse_end + n }));
       });
-  } else {
-    throw WordSizeException(word_size);
+  });
+}
+
+template <>
+void GDBRequestHandler::operator()(
+    const req::QueryFeaturesReadRequest &req) const
+{
+  if (req.get_annex() != "target.xml") {
+    send_error(0x00);
+    return;
   }
+
+  visit_target_registers([&](auto registers) {
+    const auto &xml = get_target_xml<decltype(registers)>();
+    const auto offset = std::min(req.get_offset(), xml.size());
+    const auto chunk = xml.substr(offset, req.get_length());
+    send(rsp::QueryFeaturesReadResponse(chunk, offset + chunk.size() >= xml.size()));
+  });
 }
 
 template <>
@@ -130,50 +389,27 @@ void GDBRequestHandler::operator()(
   send(rsp::QueryProcessInfoResponse(1));
 }
 
-// TODO: impl is PV-specific for now
 template <>
 void GDBRequestHandler::operator()(
     const req::QueryMemoryRegionInfoRequest &req) const
 {
-  send(rsp::NotSupportedResponse());
-
   /*
-  const auto address = req.get_address();
-
-  auto perms = _debugger.get_domain().get_page_permissions(address);
-  if (perms) {
-
-    send(rsp::QueryMemoryRegionInfoResponse(
-          address & XC_PAGE_MASK, XC_PAGE_SIZE,
-          perms->read, perms->write, perms->execute));
-
-  } else {
-
-    \* If the current region (page) isn't present, LLDB expects that we
-     * provide a region that represents the space before the next
-     * one that IS present.
-     *\
-
-    const auto MAX_ADDRESS = _debugger.get_domain().get_max_gpfn() << XC_PAGE_SHIFT;
-    auto address_end = address;
-
-    do {
-      address_end += std::min(XC_PAGE_SIZE, MAX_ADDRESS - address);
-      perms = _debugger.get_domain().get_page_permissions(address_end);
-    } while (address_end < MAX_ADDRESS && !perms);
-
-    send(rsp::QueryMemoryRegionInfoResponse(
-          address & XC_PAGE_MASK, address_end - address,
-          false, false, false));
-  }
-  */
+   * If the address isn't mapped, LLDB expects a region without permissions
+   * that represents the space before the next one that IS mapped, which is
+   * exactly what the region map gives back.
+   */
+  const auto region_map = _debugger.get_domain().get_region_map(_debugger.get_vcpu_id());
+  const auto region = region_map->find(req.get_address());
+
+  send(rsp::QueryMemoryRegionInfoResponse(
+        region.start, region.size, region.read, region.write, region.execute));
 }
 
 template <>
 void GDBRequestHandler::operator()(
     const req::QueryCurrentThreadIDRequest &) const
 {
-  send(rsp::QueryCurrentThreadIDResponse(_debugger.get_vcpu_id()));
+  send(rsp::QueryCurrentThreadIDResponse(_debugger.get_vcpu_id()+1));
 }
 
 template <>
@@ -193,7 +429,8 @@ void GDBRequestHandler::operator()(
 void GDBRequestHandler::send_stop_reply(dbg::StopReason reason_any) const {
   std::visit(util::overloaded {
     [this](dbg::StopReasonBreakpoint reason) {
-      send(rsp::StopReasonSignalResponse(reason.signal, reason.vcpu_id, get_thread_ids()));
+      send(rsp::StopReasonSignalResponse(reason.signal, reason.vcpu_id,
+            get_thread_ids(), get_thread_pcs()));
     }, [this](dbg::StopReasonWatchpoint reason) {
       std::string type_str;
       switch (reason.type) {
@@ -208,8 +445,8 @@ void GDBRequestHandler::send_stop_reply(dbg::StopReason reason_any) const {
       std::stringstream ss;
       ss << std::hex << reason.address;
 
-      send(rsp::StopReasonSignalResponse(reason.signal, reason.vcpu_id, get_thread_ids(),
-            type_str, ss.str()));
+      send(rsp::StopReasonSignalResponse(reason.signal, reason.vcpu_id,
+            get_thread_ids(), get_thread_pcs(), type_str, ss.str()));
     }
   }, reason_any);
 }
@@ -235,8 +472,9 @@ void GDBRequestHandler::operator()(
 {
   // TODO: -1 means "all threads"... need to implement better support for this
   const auto thread_id = req.get_thread_id();
+  // Thread IDs are VCPU IDs plus one, as thread ID 0 means "any thread"
   if (thread_id != (size_t)-1 && thread_id != 0)
-    _debugger.set_vcpu_id(thread_id);
+    _debugger.set_vcpu_id(thread_id-1);
   send(rsp::OKResponse());
 }
 
@@ -246,18 +484,19 @@ void GDBRequestHandler::operator()(
 {
   const auto id = req.get_register_id();
   const auto thread_id = req.get_thread_id();
-  const auto vcpu_id = (thread_id == (size_t)-1) ? 0 : thread_id-1;
-  const auto regs = _debugger.get_domain().get_cpu_context(vcpu_id);
-
-  std::visit(util::overloaded {
-      [&](const auto &regs) {
-        regs.find_by_id(id, [&](const auto&, const auto &reg) {
-          send(rsp::RegisterReadResponse(reg));
-        }, [&]() {
-          send_error(0x45, "No register with ID " + std::to_string(id));
-        });
-      }
-  }, regs);
+  const auto vcpu_id = get_vcpu_id(thread_id);
+
+  // Cut from the same encoding as 'g', so that it covers every register
+  // described to the client
+  const auto regs_hex = _debugger.get_domain().get_cpu_context_hex(vcpu_id);
+
+  visit_target_registers([&](auto registers) {
+    decltype(registers)::Target::find_metadata_by_id(id, [&](const auto &md) {
+      send(rsp::RegisterReadResponse(regs_hex.substr(2*md.offset, 2*md.width)));
+    }, [&]() {
+      send_error(0x45, "No register with ID " + std::to_string(id));
+    });
+  });
 }
 
 template <>
@@ -265,21 +504,34 @@ void GDBRequestHandler::operator()(
     const req::RegisterWriteRequest &req) const
 {
   const auto id = req.get_register_id();
-  const auto value = req.get_value();
+  const auto &value_hex = req.get_value_hex();
   const auto thread_id = req.get_thread_id();
-  const auto vcpu_id = (thread_id == (size_t)-1) ? 0 : thread_id-1;
+  const auto vcpu_id = get_vcpu_id(thread_id);
+
+  // Spliced into the same encoding as 'G', so that it covers every register
+  // described to the client, at its real width
+  auto regs_hex = _debugger.get_domain().get_cpu_context_hex(vcpu_id);
+
+  std::optional<std::pair<size_t, size_t>> slice;
+  visit_target_registers([&](auto registers) {
+    decltype(registers)::Target::find_metadata_by_id(id, [&](const auto &md) {
+      slice = std::make_pair(2*md.offset, 2*md.width);
+    }, []() {});
+  });
+
+  if (!slice) {
+    send_error(0x45, "No register with ID " + std::to_string(id));
+    return;
+  }
 
-  auto regs = _debugger.get_domain().get_cpu_context(vcpu_id);
-  std::visit(util::overloaded {
-      [&](auto &regs) {
-        regs.find_by_id(id, [&value](const auto&, auto &reg) {
-          reg = value;
-        }, [&]() {
-          send_error(0x45, "No register with ID " + std::to_string(id));
-        });
-      }
-  }, regs);
-  _debugger.get_domain().set_cpu_context(regs, vcpu_id);
+  const auto [offset, size] = *slice;
+  if (value_hex.size() != size) {
+    send_error(0x45, "Wrong size for register with ID " + std::to_string(id));
+    return;
+  }
+
+  regs_hex.replace(offset, size, value_hex);
+  _debugger.get_domain().set_cpu_context_hex(regs_hex, vcpu_id);
   send(rsp::OKResponse());
 }
 
@@ -288,50 +540,45 @@ void GDBRequestHandler::operator()(
     const req::GeneralRegistersBatchReadRequest &req) const
 {
   const auto thread_id = req.get_thread_id();
-  const auto vcpu_id = (thread_id == (size_t)-1) ? 0 : thread_id-1;
-  std::visit(util::overloaded {
-      [&](const auto &regs) {
-        send(rsp::GeneralRegistersBatchReadResponse(regs));
-      }
-  }, _debugger.get_domain().get_cpu_context(vcpu_id));
+  const auto vcpu_id = get_vcpu_id(thread_id);
+  send(rsp::GeneralRegistersBatchReadResponse(
+      _debugger.get_domain().get_cpu_context_hex(vcpu_id)));
 }
 
 template <>
 void GDBRequestHandler::operator()(
     const req::GeneralRegistersBatchWriteRequest &req) const
 {
-  auto regs_any = _debugger.get_domain().get_cpu_context(_debugger.get_vcpu_id());
-  auto values = req.get_values();
+  const auto thread_id = req.get_thread_id();
+  const auto vcpu_id = get_vcpu_id(thread_id);
+  _debugger.get_domain().set_cpu_context_hex(req.get_registers_hex(), vcpu_id);
 
-  std::visit(util::overloaded {
-      [&values](auto &orig_regs) {
-        size_t size = 0;
-        while (!values.empty()) {
-          const auto pair = values.back();
-          values.pop_back();
-
-          // For some reason, if I do [id, value] = values.back(),
-          // 'value' isn't available for the lambda capture below
-          const auto id = pair.first;
-          const auto value = pair.second;
-
-          orig_regs.find_by_id(id, [&](const auto &md, auto &reg) {
-            std::visit(util::overloaded {
-                [&](const auto &value) {
-                  reg = value;
-                  size = md.offset + md.width;
-                }
-            }, value);
-          }, [&]() {
-            throw PacketSizeException(size, orig_regs.size);
-          });
-        }
-      }
-  }, regs_any);
+  send(rsp::OKResponse());
+}
+
+template <>
+void GDBRequestHandler::operator()(
+    const req::SaveRegisterStateRequest &req) const
+{
+  const auto thread_id = req.get_thread_id();
+  const auto vcpu_id = get_vcpu_id(thread_id);
+  send(rsp::SaveRegisterStateResponse(
+      _debugger.get_domain().save_cpu_context(vcpu_id)));
+}
 
-  _debugger.get_domain().set_cpu_context(regs_any, _debugger.get_vcpu_id());
+template <>
+void GDBRequestHandler::operator()(
+    const req::RestoreRegisterStateRequest &req) const
+{
+  const auto save_id = req.get_save_id();
+  const auto thread_id = req.get_thread_id();
+  const auto vcpu_id = get_vcpu_id(thread_id);
 
-  send(rsp::OKResponse());
+  if (_debugger.get_domain().restore_cpu_context(save_id, vcpu_id))
+    send(rsp::OKResponse());
+  else
+    send_error(0x45, "No saved register state with ID " + std::to_string(save_id) +
+        " for VCPU " + std::to_string(vcpu_id));
 }
 
 template <>
@@ -341,8 +588,8 @@ void GDBRequestHandler::operator()(
   const auto address = req.get_address();
   const auto length = req.get_length();
 
-  const auto data = _debugger.read_memory_masking_breakpoints(address, length);
-  send(rsp::MemoryReadResponse(data.get(), length));
+  send(rsp::MemoryReadResponse(
+        _debugger.read_memory_masking_breakpoints(address, length)));
 }
 
 template <>
@@ -351,13 +598,45 @@ void GDBRequestHandler::operator()(
 {
   const auto address = req.get_address();
   const auto length = req.get_length();
-  const auto data = req.get_data();
+  const auto &data = req.get_data();
 
   _debugger.write_memory_retaining_breakpoints(
       address, length, (void*)&data[0]);
   send(rsp::OKResponse());
 }
 
+template <>
+void GDBRequestHandler::operator()(
+    const req::MemoryReadBinaryRequest &req) const
+{
+  const auto address = req.get_address();
+  const auto length = req.get_length();
+
+  // Clients probe for 'x' support with an empty read
+  if (!length) {
+    send(rsp::MemoryReadBinaryResponse());
+    return;
+  }
+
+  send(rsp::MemoryReadBinaryResponse(
+        _debugger.read_memory_masking_breakpoints(address, length)));
+}
+
+template <>
+void GDBRequestHandler::operator()(
+    const req::MemoryWriteBinaryRequest &req) const
+{
+  const auto address = req.get_address();
+  const auto length = req.get_length();
+  const auto &data = req.get_data();
+
+  // Clients probe for 'X' support with an empty write
+  if (length)
+    _debugger.write_memory_retaining_breakpoints(
+        address, length, (void*)data.data());
+  send(rsp::OKResponse());
+}
+
 template <>
 void GDBRequestHandler::operator()(
     const req::ContinueRequest &) const
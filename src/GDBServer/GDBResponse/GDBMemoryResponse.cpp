@@ -20,17 +20,46 @@
 //
 
 #include <GDBServer/GDBResponse/GDBMemoryResponse.hpp>
+#include <Util/hex.hpp>
 
 using namespace xd::gdb::rsp;
+using xd::gdb::GDBPacketWriter;
 
 std::string MemoryReadResponse::to_string() const {
-  std::stringstream ss;
+  std::string s(2*_data.size(), '\0');
 
-  ss << std::hex << std::setfill('0');
-  std::for_each(_data.begin(), _data.end(),
-  [&ss](const unsigned char &ch) {
-  ss << std::setw(2) << (unsigned)ch;
+  auto out = s.data();
+  _data.for_each_chunk([&out](const unsigned char *chunk, size_t length) {
+    xd::util::hex::encode(chunk, length, out);
+    out += 2*length;
   });
 
-  return ss.str();
+  return s;
+};
+
+void MemoryReadResponse::write(GDBPacketWriter &writer) const {
+  _data.for_each_chunk([&writer](const unsigned char *chunk, size_t length) {
+    writer.write_hex(chunk, length);
+  });
+};
+
+// The escaping lives in the packet writer, so borrow one and strip the
+// framing back off
+std::string MemoryReadBinaryResponse::to_string() const {
+  GDBPacketWriter writer;
+  writer.begin();
+  write(writer);
+
+  const auto packet = writer.end();
+  return std::string(packet.substr(1, packet.size() - 4));
+};
+
+void MemoryReadBinaryResponse::write(GDBPacketWriter &writer) const {
+  writer.write('b');
+  if (!_data)
+    return;
+
+  _data->for_each_chunk([&writer](const unsigned char *chunk, size_t length) {
+    writer.write_binary(chunk, length);
+  });
 };
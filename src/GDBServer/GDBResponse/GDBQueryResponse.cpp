@@ -22,6 +22,7 @@
 #include <GDBServer/GDBResponse/GDBQueryResponse.hpp>
 
 using namespace xd::gdb::rsp;
+using xd::gdb::GDBPacketWriter;
 
 std::string QueryWatchpointSupportInfoResponse::to_string() const {
   std::stringstream ss;
@@ -131,13 +132,36 @@ std::string QueryRegisterInfoResponse::to_string() const {
   std::stringstream ss;
   add_map_entry(ss, "name", _name);
   add_map_entry(ss, "bitsize", _width);
-  add_map_entry(ss, "offset", _offset);
-  add_map_entry(ss, "encoding", "uint");
-  add_map_entry(ss, "format", "hex");
-  add_map_entry(ss, "set", "General Purpose Registers");
+  if (_value_regs.empty())
+    add_map_entry(ss, "offset", _offset);
+  add_map_entry(ss, "encoding", _encoding);
+  add_map_entry(ss, "format", _format);
+  add_map_entry(ss, "set", _set);
+  if (!_value_regs.empty()) {
+    // Register numbers here are hex, unlike everywhere else in the reply
+    ss << "value-regs:" << std::hex;
+    for (size_t i = 0; i < _value_regs.size(); ++i)
+      ss << (i ? "," : "") << _value_regs[i];
+    ss << std::dec << ";";
+  }
   if (_gcc_register_id != (size_t)-1) {
     add_map_entry(ss, "ehframe", _gcc_register_id);
     add_map_entry(ss, "dwarf", _gcc_register_id); // TODO
   }
   return ss.str();
 };
+
+// As for 'x' replies, the escaping lives in the packet writer
+std::string QueryFeaturesReadResponse::to_string() const {
+  GDBPacketWriter writer;
+  writer.begin();
+  write(writer);
+
+  const auto packet = writer.end();
+  return std::string(packet.substr(1, packet.size() - 4));
+};
+
+void QueryFeaturesReadResponse::write(GDBPacketWriter &writer) const {
+  writer.write(_is_last ? 'l' : 'm');
+  writer.write_binary(_data.data(), _data.size());
+};
@@ -49,6 +49,12 @@ std::string StopReasonSignalResponse::to_string() const {
   else
     for (const auto thread_id : _thread_ids)
       add_list_entry(ss, thread_id);
+  if (!_thread_pcs.empty()) {
+    // Spares LLDB from reading every thread's PC separately
+    ss << ";thread-pcs:";
+    for (const auto pc : _thread_pcs)
+      add_list_entry(ss, pc);
+  }
   ss << ";reason:signal;";
   return ss.str();
 };
@@ -19,6 +19,8 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <chrono>
+#include <climits>
 #include <experimental/filesystem>
 #include <iomanip>
 #include <iostream>
@@ -27,6 +29,7 @@
 
 #include <elfio/elfio.hpp>
 
+#include <GDBServer/GDBPacketWriter.hpp>
 #include <Util/string.hpp>
 #include <Xen/XenException.hpp>
 #include <Xen/Xen.hpp>
@@ -45,6 +48,7 @@
 using xd::dbg::Debugger;
 using xd::dbg::DebuggerREPL;
 using xd::dbg::InvalidInputException;
+using xd::gdb::GDBPacketWriter;
 using xd::parser::Parser;
 using xd::parser::expr::Constant;
 using xd::parser::expr::Expression;
@@ -108,10 +112,6 @@ void DebuggerREPL::run() {
       std::cout << "Invalid input! Parse failed at:" << std::endl;
       std::cout << e.input() << std::endl;
       std::cout << std::string(e.pos(), ' ') << "^" << std::endl;
-    } catch (const parser::except::ExpectException &e) {
-      std::cout << "Invalid input! Parse failed at:" << std::endl;
-      std::cout << e.input() << std::endl;
-      std::cout << std::string(e.pos(), ' ') << "^" << std::endl;
     } catch (const NoSuchVariableException &e) {
       std::cout << "No such variable: " << e.what() << std::endl;
     } catch (const NotSupportedException &e) {
@@ -188,6 +188,20 @@ void DebuggerREPL::setup_repl() {
           std::cout << "CPU " << _vcpu_id << " (max: " << _max_vcpu_id << ")" << std::endl;
         };
       }),
+    Verb("list", "List all CPUs and where they are.",
+      {},
+      {},
+      [this](auto &/*flags*/, auto &/*args*/) {
+        return [this]() {
+          const auto &domain = _dwrap.get_debugger_or_fail()->get_domain();
+          const auto contexts = domain.get_cpu_contexts();
+          for (size_t id = 0; id < contexts.size(); ++id) {
+            const auto pc = reg::read_register<reg::x86_32::eip, reg::x86_64::rip>(contexts[id]);
+            std::cout << (id == _vcpu_id ? "* " : "  ") << "CPU " << std::dec << id
+              << "\t" << std::showbase << std::hex << pc << std::dec << std::endl;
+          }
+        };
+      }),
     Verb("set", "Switch to a new CPU.",
       {},
       {
@@ -407,9 +421,26 @@ void DebuggerREPL::setup_repl() {
         [this](auto &/*flags*/, auto &/*args*/) {
           return [this]() {
             auto &domain = _dwrap.get_domain_or_fail();
+            domain.refresh_dominfo();
             print_domain_info(domain);
           };
         }),
+      Verb("cache", "Query hit rates of the current guest's caches.",
+        {}, {},
+        [this](auto &/*flags*/, auto &/*args*/) {
+          return [this]() {
+            auto &domain = _dwrap.get_domain_or_fail();
+            print_cache_stats(domain);
+          };
+        }),
+      Verb("mappings", "Query the virtual address space of the current CPU.",
+        {}, {},
+        [this](auto &/*flags*/, auto &/*args*/) {
+          return [this]() {
+            auto &domain = _dwrap.get_domain_or_fail();
+            print_mappings(*domain.get_region_map(_vcpu_id));
+          };
+        }),
       Verb("registers", "Query the register state of the current domain.",
         {}, {},
         [this](auto &/*flags*/, auto &/*args*/) {
@@ -589,6 +620,33 @@ void DebuggerREPL::setup_repl() {
         };
       })));
 
+  _repl.add_command(make_command("benchmark", "Time the debugger's hot paths.", {
+    Verb("memory", "Time the ways of reading guest memory at an address.",
+      {},
+      {
+        Argument("addr", "The address to read from.",
+            match_everything<std::string::const_iterator>),
+      },
+      [this](auto &/*flags*/, auto &args) {
+        const auto address_str = args.get(0);
+
+        return [this, address_str]() {
+          Parser parser;
+          const auto address_expr = parser.parse(address_str);
+          const auto address = _dwrap.evaluate_expression(address_expr);
+
+          benchmark_memory(_dwrap.get_domain_or_fail(), address);
+        };
+      }),
+    Verb("hex", "Time encoding memory reads as packets for GDB.",
+      {}, {},
+      [](auto &/*flags*/, auto &/*args*/) {
+        return []() {
+          benchmark_hex_encoding();
+        };
+      }),
+  }));
+
   _repl.add_command(make_command(
       Verb("examine", "Read memory.",
         {
@@ -873,6 +931,104 @@ void DebuggerREPL::print_domain_info(const xen::Domain &domain) {
     << (dominfo.crashed ? "Crashed" : (dominfo.paused ? "Paused" : "Running")) << std::endl;
 }
 
+void DebuggerREPL::print_cache_stats(const xen::Domain &domain) {
+  const auto &cache = domain.get_memory_cache();
+  const auto &stats = cache.get_stats();
+  std::cout
+    << "Mapped pages: " << cache.get_size() << "/" << cache.get_capacity()
+    << " (" << stats.hits << " hits, " << stats.misses << " misses, "
+    << stats.evictions << " evictions)" << std::endl;
+
+  const auto &tlb = domain.get_translation_cache();
+  const auto &tlb_stats = tlb.get_stats();
+  std::cout
+    << "Translations: " << tlb.get_size()
+    << " (" << tlb_stats.hits << " hits, " << tlb_stats.misses << " misses, "
+    << tlb_stats.flushes << " flushes)" << std::endl;
+
+  const auto &info_stats = domain.get_info_cache().get_stats();
+  std::cout
+    << "Domain info: " << info_stats.hits << " hits, " << info_stats.misses << " misses, "
+    << info_stats.refreshes << " refreshes" << std::endl;
+
+  const auto reg_stats = domain.get_register_cache_stats();
+  std::cout
+    << "CPU contexts: " << reg_stats.hits << " hits, " << reg_stats.misses << " misses, "
+    << reg_stats.flushes << " flushes, " << reg_stats.write_backs << " write-backs" << std::endl;
+}
+
+void DebuggerREPL::benchmark_memory(const xen::Domain &domain, uint64_t address) {
+  using Backend = xen::Domain::MemoryBackend;
+  using Clock = std::chrono::steady_clock;
+
+  const size_t iterations = 256;
+  std::vector<char> buffer(2*XC_PAGE_SIZE);
+
+  const auto time_reads = [&](size_t size, Backend backend, bool cold) {
+    const auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+      // A cold read has to walk the page tables as well as map the page
+      if (cold) {
+        domain.flush_translation_cache();
+        domain.flush_memory_cache();
+      }
+      domain.read_memory(address, buffer.data(), size, backend);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start);
+    return elapsed.count() / iterations;
+  };
+
+  std::cout << "Nanoseconds per read:" << std::endl
+    << std::setw(8) << "size"
+    << std::setw(12) << "map (cold)"
+    << std::setw(12) << "map (warm)"
+    << std::setw(12) << "guestmemio" << std::endl;
+
+  for (size_t size = 1; size <= buffer.size(); size *= 4) {
+    std::cout << std::setw(8) << size
+      << std::setw(12) << time_reads(size, Backend::ForeignMapping, true)
+      << std::setw(12) << time_reads(size, Backend::ForeignMapping, false)
+      << std::setw(12) << time_reads(size, Backend::GuestMemIO, false) << std::endl;
+  }
+}
+
+// What the GDB server adds on top of a memory read when sending the data
+// back as an 'm' response: hex encoding plus packet framing. Needs no guest.
+void DebuggerREPL::benchmark_hex_encoding() {
+  using Clock = std::chrono::steady_clock;
+
+  const size_t iterations = 256;
+  const std::vector<unsigned char> data(0x10000);
+  GDBPacketWriter writer;
+
+  const auto start = Clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    writer.begin();
+    writer.write_hex(data.data(), data.size());
+    writer.end();
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - start);
+
+  std::cout << "Nanoseconds to encode a " << data.size() << "-byte read as a packet: "
+    << elapsed.count() / iterations << std::endl;
+}
+
+void DebuggerREPL::print_mappings(const xen::RegionMap &region_map) {
+  std::cout << std::hex << std::setfill('0');
+  region_map.for_each([](const auto &region) {
+    std::cout
+      << "0x" << std::setw(16) << region.start << "-"
+      << "0x" << std::setw(16) << (region.start + region.size - 1) << " "
+      << (region.read ? "r" : "-")
+      << (region.write ? "w" : "-")
+      << (region.execute ? "x" : "-") << " "
+      << (region.user ? "user" : "supervisor") << std::endl;
+  });
+  std::cout << std::dec << std::setfill(' ');
+}
+
 void DebuggerREPL::print_registers(const reg::RegistersX86Any& regs) {
   std::cout << std::hex << std::showbase;
 
@@ -898,8 +1054,9 @@ void DebuggerREPL::print_xen_info(const xen::Xen &xen) {
 }
 
 void DebuggerREPL::disassemble(uint64_t address, size_t length, size_t max_instrs) {
-  auto mem_handle = _dwrap.examine(address, 1, length);
-  auto mem = mem_handle.get();
+  const auto mem_handle = _dwrap.examine(address, 1, length);
+  std::vector<unsigned char> buffer;
+  const auto mem = mem_handle.flatten(buffer);
 
   cs_insn *insn;
   auto count = cs_disasm(_capstone, mem, length, address, 0, &insn);
@@ -917,8 +1074,7 @@ void DebuggerREPL::disassemble(uint64_t address, size_t length, size_t max_instr
 }
 
 void DebuggerREPL::examine(uint64_t address, size_t word_size, size_t num_words) {
-  auto mem_handle = _dwrap.examine(address, word_size, num_words);
-  auto mem = (char*)mem_handle.get();
+  const auto mem = _dwrap.examine(address, word_size, num_words);
 
   const auto newline_limit = 3*sizeof(uint64_t)/word_size;
 
@@ -926,9 +1082,9 @@ void DebuggerREPL::examine(uint64_t address, size_t word_size, size_t num_words)
   std::cout << address << " to " << address + word_size*num_words << ":" << std::endl;
   std::cout << std::noshowbase << std::setfill('0');
   for (size_t i = 0; i < num_words; ++i) {
-    char *target = mem+(i+1)*word_size;
+    size_t target = (i+1)*word_size;
     for (size_t j = 0; j < word_size; ++j) {
-      std::cout << std::setw(2) << (((uint32_t)(*--target)) & 0xFF);
+      std::cout << std::setw(2) << (uint32_t)mem[--target];
     }
     std::cout << " ";
 
@@ -62,7 +62,11 @@ namespace xd::dbg {
   private:
     void setup_repl();
 
+    static void benchmark_memory(const xen::Domain& domain, uint64_t address);
+    static void benchmark_hex_encoding();
     static void print_domain_info(const xen::Domain& domain);
+    static void print_cache_stats(const xen::Domain& domain);
+    static void print_mappings(const xen::RegionMap& region_map);
     static void print_registers(const reg::RegistersX86Any& regs);
     static void print_xen_info(const xen::Xen& xen);
     void examine(uint64_t address, size_t word_size, size_t num_words);
@@ -186,10 +186,8 @@ void DebuggerWrapper::evaluate_set_expression(const Expression &expr, size_t wor
     auto regs = _debugger->get_domain().get_cpu_context(_vcpu_id); // TODO
 
     std::visit(util::overloaded {
-      [&](auto regs) {
-        regs.find([&](auto reg) {
-          return reg.name == var_name;
-        }, [&](const auto &md, auto &reg) {
+      [&](auto &regs) {
+        regs.find_by_name(var_name, [&](const auto &, auto &reg) {
           reg = value;
         }, [&]() {
           set_var(var_name, value); // not a register
@@ -228,9 +226,7 @@ uint64_t DebuggerWrapper::evaluate_expression(const Expression& expr) {
 
         std::visit(util::overloaded {
             [&](const auto &regs) {
-              regs.find([&](auto reg) {
-                return reg.name == var_name;
-              }, [&](const auto &md, auto &reg) {
+              regs.find_by_name(var_name, [&](const auto &, auto &reg) {
                 ret = reg;
               }, [&]() {
                 ret = get_var(var_name); // not a register
@@ -249,7 +245,9 @@ uint64_t DebuggerWrapper::evaluate_expression(const Expression& expr) {
               assert_attached();
               // TODO: only reads 64-bit values for now
               const auto mem = _debugger->read_memory_masking_breakpoints(x_value, sizeof(uint64_t));
-              return *((uint64_t*)mem.get());
+              uint64_t value;
+              mem.copy(&value, 0, sizeof(value));
+              return value;
             },
             [x_value](Negate) {
               return -x_value;
@@ -23,6 +23,7 @@
 #define XENDBG_SENTINEL_HPP
 
 #include <cstddef>
+#include <limits>
 
 #include "Expression/Operator/Precedence.hpp"
 
@@ -63,11 +63,13 @@ void ServerModeController::run_single(xen::DomID domid) {
   watch_release.add_path("@releaseDomain");
 
   _poll->on<uvw::PollEvent>([&](const auto &event, auto &handle) {
-    if (watch_release.check() && !_instances.empty())
+    if (watch_release.check() && !_instances.empty()) {
+      refresh_instances();
       if (prune_instances()) {
         stop();
         exit(0);
       }
+    }
   });
 
   _poll->start(uvw::PollHandle::Event::READABLE);
@@ -86,10 +88,12 @@ void ServerModeController::run_multi() {
   watch_release.add_path("@releaseDomain");
 
   _poll->on<uvw::PollEvent>([&](const auto&, auto&) {
-    if (watch_introduce.check())
+    if (watch_introduce.check()) {
       add_new_instances();
-    else if (watch_release.check())
+    } else if (watch_release.check()) {
+      refresh_instances();
       prune_instances();
+    }
   });
 
   _poll->start(uvw::PollHandle::Event::READABLE);
@@ -135,6 +139,12 @@ size_t ServerModeController::add_new_instances() {
   return num_added;
 }
 
+void ServerModeController::refresh_instances() {
+  // Domains that are still around may have shut down or crashed
+  for (auto &instance : _instances)
+    instance.second->refresh_domain_state();
+}
+
 size_t ServerModeController::prune_instances() {
   const auto domains = _xen->get_domains();
 
@@ -71,6 +71,7 @@ namespace xd {
     void stop();
 
     size_t add_new_instances();
+    void refresh_instances();
     size_t prune_instances();
 
     void add_instance(xen::DomainAny domain);
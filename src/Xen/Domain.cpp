@@ -19,6 +19,8 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <algorithm>
+
 #include <Xen/Domain.hpp>
 #include <Xen/Xen.hpp>
 #include <Xen/XenForeignMemory.hpp>
@@ -29,41 +31,22 @@ using xd::reg::RegistersX86Any;
 using xd::xen::Address;
 using xd::xen::Domain;
 using xd::xen::DomInfo;
+using xd::xen::DomainInfoCache;
+using xd::xen::ForeignMemoryCache;
 using xd::xen::MemInfo;
+using xd::xen::PageTableWalker;
+using xd::xen::PagingMode;
+using xd::xen::TranslationCache;
 using xd::xen::Xen;
 using xd::xen::XenCall;
 using xd::xen::XenForeignMemory;
 
 #define CR0_PG 0x80000000
-#define CR4_PAE 0x2
-#define PTE_PSE 0x80
+#define CR4_PAE 0x20
+#define CR4_LA57 0x1000
+#define CR3_ADDR_MASK 0x000ffffffffff000ull
 #define EFER_LMA 0x400
 
-// from xc_private.c
-
-static int xc_ffs8(uint8_t x) {
-  int i;
-  for ( i = 0; i < 8; i++ )
-    if ( x & (1u << i) )
-      return i+1;
-  return 0;
-}
-
-static int xc_ffs16(uint16_t x) {
-  uint8_t h = x>>8, l = x;
-  return l ? xc_ffs8(l) : h ? xc_ffs8(h) + 8 : 0;
-}
-
-static int xc_ffs32(uint32_t x) {
-  uint16_t h = x>>16, l = x;
-  return l ? xc_ffs16(l) : h ? xc_ffs16(h) + 16 : 0;
-}
-
-static int xc_ffs64(uint64_t x) {
-  uint32_t h = x>>32, l = x;
-  return l ? xc_ffs32(l) : h ? xc_ffs32(h) + 32 : 0;
-}
-
 void Domain::set_debugging(bool enable, VCPU_ID vcpu_id) const {
   if (vcpu_id > get_dominfo().max_vcpu_id)
     throw XenException(
@@ -80,7 +63,10 @@ void Domain::set_debugging(bool enable, VCPU_ID vcpu_id) const {
 }
 
 Domain::Domain(DomID domid, std::shared_ptr<Xen> xen)
-    : _domid(domid), _xen(std::move(xen))
+    : _domid(domid), _xen(std::move(xen)),
+      _memory_cache(std::make_shared<ForeignMemoryCache>()),
+      _translation_cache(std::make_shared<TranslationCache>()),
+      _info_cache(std::make_shared<DomainInfoCache>())
 {
   const auto vcpu_count = get_dominfo().max_vcpu_id + 1;
   _vcpu_pause_state.resize(vcpu_count);
@@ -99,22 +85,56 @@ std::string Domain::get_kernel_path() const {
 }
 
 DomInfo Domain::get_dominfo() const {
-  return _xen->xenctrl.get_domain_info(_domid);
+  return _info_cache->get_dominfo([this]() {
+    return _xen->xenctrl.get_domain_info(_domid);
+  });
 }
 
 int Domain::get_word_size() const {
-  int err;
-  unsigned int word_size;
-  if ((err = xc_domain_get_guest_width(_xen->xenctrl.get(), _domid, &word_size))) {
-    throw XenException(
-        "Failed to get word size for domain " + std::to_string(_domid),
-        -err);
-  }
-  return word_size;
+  return _info_cache->get_word_size([this]() {
+    int err;
+    unsigned int word_size;
+    if ((err = xc_domain_get_guest_width(_xen->xenctrl.get(), _domid, &word_size))) {
+      throw XenException(
+          "Failed to get word size for domain " + std::to_string(_domid),
+          -err);
+    }
+    return (int)word_size;
+  });
+}
+
+void Domain::refresh_dominfo() const {
+  _info_cache->refresh();
+}
+
+std::optional<Address> Domain::translate_foreign_address(Address vaddr, VCPU_ID vcpu_id) const {
+  const auto mode = get_paging_mode(vcpu_id);
+  const auto vpage = vaddr >> XC_PAGE_SHIFT;
+  const auto cached = is_stopped(vcpu_id);
+
+  if (cached)
+    if (const auto mfn = _translation_cache->lookup(vcpu_id, mode.root, vpage))
+      return mfn;
+
+  PageTableWalker walker(*this, mode);
+  const auto mapping = walker.translate(vaddr);
+  if (!mapping)
+    return std::nullopt;
+
+  const auto mfn = mapping->mfn + ((vaddr & (mapping->size - 1)) >> XC_PAGE_SHIFT);
+  if (cached)
+    _translation_cache->insert(vcpu_id, mode.root, vpage, mfn);
+
+  return mfn;
+}
+
+void Domain::invalidate_caches() const {
+  _translation_cache->flush();
 }
 
-Address Domain::translate_foreign_address(Address vaddr, VCPU_ID vcpu_id) const {
-  return xc_translate_foreign_address(_xen->xenctrl.get(), _domid, vcpu_id, vaddr);
+bool Domain::is_stopped(VCPU_ID vcpu_id) const {
+  return get_dominfo().paused ||
+    (vcpu_id < _vcpu_pause_state.size() && _vcpu_pause_state[vcpu_id]);
 }
 
 MemInfo Domain::map_meminfo() const {
@@ -138,67 +158,74 @@ MemInfo Domain::map_meminfo() const {
   return meminfo;
 }
 
-// modified version of xc_translate_foreign_address in xc_pagetab.c
 std::optional<xd::xen::PageTableEntry> Domain::get_page_table_entry(Address vaddr, VCPU_ID vcpu_id) const {
+  PageTableWalker walker(*this, get_paging_mode(vcpu_id));
+  if (const auto mapping = walker.translate(vaddr))
+    return mapping->pte;
+  return std::nullopt;
+}
+
+std::shared_ptr<const xd::xen::RegionMap> Domain::get_region_map(VCPU_ID vcpu_id) const {
+  const auto cached = is_stopped(vcpu_id);
+  if (cached)
+    if (auto region_map = _translation_cache->get_region_map(vcpu_id))
+      return region_map;
+
+  PageTableWalker walker(*this, get_paging_mode(vcpu_id));
+  auto region_map = std::make_shared<const RegionMap>(walker);
+  if (cached)
+    _translation_cache->set_region_map(vcpu_id, region_map);
+  return region_map;
+}
+
+std::vector<RegistersX86Any> Domain::get_cpu_contexts() const {
+  const auto max_vcpu_id = get_dominfo().max_vcpu_id;
+
+  std::vector<RegistersX86Any> contexts;
+  contexts.reserve(max_vcpu_id + 1);
+  for (VCPU_ID vcpu_id = 0; vcpu_id <= max_vcpu_id; ++vcpu_id)
+    contexts.push_back(get_cpu_context(vcpu_id));
+  return contexts;
+}
+
+// based on xc_translate_foreign_address in xc_pagetab.c
+PagingMode Domain::get_paging_mode(VCPU_ID vcpu_id) const {
+  const auto cached = is_stopped(vcpu_id);
+  if (cached)
+    if (const auto mode = _translation_cache->get_paging_mode(vcpu_id))
+      return *mode;
+
   // FYI: "cr3" is the register that holds the base address of the page table
   const auto [cr0, cr3, cr4, msr_efer] = std::visit(util::overloaded {
     [](const auto &regs) {
       return std::make_tuple(
-          regs.template get<reg::x86::cr0>(),
-          regs.template get<reg::x86::cr3>(),
-          regs.template get<reg::x86::cr4>(),
-          regs.template get<reg::x86::msr_efer>());
+          (uint64_t)regs.template get<reg::x86::cr0>(),
+          (uint64_t)regs.template get<reg::x86::cr3>(),
+          (uint64_t)regs.template get<reg::x86::cr4>(),
+          (uint64_t)regs.template get<reg::x86::msr_efer>());
     }}, get_cpu_context(vcpu_id));
 
-    uint64_t paddr, mask, pte;
-    size_t pt_levels;
-
-    if (get_dominfo().hvm) {
-      if (!(cr0 & CR0_PG))
-        return vaddr >> XC_PAGE_SHIFT;
-      pt_levels = (msr_efer & EFER_LMA) ? 4 : (cr4 & CR4_PAE) ? 3 : 2;
-      paddr = cr3 & ((pt_levels == 3) ? ~0x1full : ~0xfffull);
+  PagingMode mode;
+  if (get_dominfo().hvm) {
+    if (!(cr0 & CR0_PG)) {
+      mode = PagingMode{0, 0};
+    } else if (msr_efer & EFER_LMA) {
+      mode = PagingMode{(cr4 & CR4_LA57) ? 5u : 4u, cr3 & CR3_ADDR_MASK};
+    } else if (cr4 & CR4_PAE) {
+      mode = PagingMode{3, cr3 & 0xffffffe0ull};
     } else {
-      if (get_word_size() == sizeof(uint64_t)) {
-        pt_levels = 4;
-        paddr = cr3;
-      } else {
-        pt_levels = 3;
-        paddr = ((cr3 >> XC_PAGE_SHIFT) | (cr3 << 20)) << XC_PAGE_SHIFT;
-      }
+      mode = PagingMode{2, cr3 & 0xfffff000ull};
     }
-
-  if (pt_levels == 4) {
-    vaddr &= 0x0000ffffffffffffull;
-    mask =  0x0000ff8000000000ull;
-  } else if (pt_levels == 3) {
-    vaddr &= 0x00000000ffffffffull;
-    mask =  0x0000007fc0000000ull;
   } else {
-    vaddr &= 0x00000000ffffffffull;
-    mask =  0x00000000ffc00000ull;
+    if (get_word_size() == sizeof(uint64_t))
+      mode = PagingMode{4, cr3 & CR3_ADDR_MASK};
+    else
+      mode = PagingMode{3, ((cr3 >> XC_PAGE_SHIFT) | (cr3 << 20)) << XC_PAGE_SHIFT};
   }
-  size_t size = (pt_levels == 2 ? sizeof(uint32_t) : sizeof(uint64_t));
 
-  /* Walk the pagetables */
-  for (size_t level = pt_levels; level > 0; level--) {
-    paddr += ((vaddr & mask) >> (xc_ffs64(mask) - 1)) * size;
-    auto map = map_memory<char>(paddr, XC_PAGE_SIZE, PROT_READ);
-
-    memcpy(&pte, map.get() + (paddr & (XC_PAGE_SIZE - 1)), size);
-
-    if (!(pte & 1))
-      return std::nullopt;
-
-    paddr = pte & 0x000ffffffffff000ull;
-    if ((level == 2 || (level == 3 && pt_levels == 4)) && (pte & PTE_PSE)) {
-      mask = ((mask ^ ~-mask) >> 1); /* All bits below first set bit */
-      return ((paddr & ~mask) | (vaddr & mask)) >> XC_PAGE_SHIFT;
-    }
-    mask >>= (pt_levels == 2 ? 10 : 9);
-  }
-
-  return pte;
+  if (cached)
+    _translation_cache->set_paging_mode(vcpu_id, mode);
+  return mode;
 }
 
 void Domain::set_mem_access(xenmem_access_t access, Address start_address, Address size) const {
@@ -244,46 +271,80 @@ void Domain::unpause_all_vcpus() {
 };
 
 void Domain::pause_unpause_vcpu(uint32_t hypercall, VCPU_ID vcpu_id) {
+  pause_unpause_vcpus(hypercall, {vcpu_id});
+}
+
+void Domain::pause_unpause_vcpus(uint32_t hypercall, const std::vector<VCPU_ID> &vcpu_ids) {
+  if (hypercall != XEN_DOMCTL_gdbsx_pausevcpu && hypercall != XEN_DOMCTL_gdbsx_unpausevcpu)
+    throw std::runtime_error("Unknown domctl!");
+  const bool pause = (hypercall == XEN_DOMCTL_gdbsx_pausevcpu);
+
+  // Even if the VCPUs turn out to be running already, pending register
+  // writes must not be held back
+  if (!pause)
+    invalidate_caches();
+
   // (Un)pausing while (un)paused has no effect
   // Otherwise the internal refcounts that Xen keeps get too complicated to manage
-  if (hypercall == XEN_DOMCTL_gdbsx_pausevcpu) {
-    if (_vcpu_pause_state[vcpu_id]) {
-      return;
-    } else {
-      _vcpu_pause_state[vcpu_id] = true;
-    }
-  } else if (hypercall == XEN_DOMCTL_gdbsx_unpausevcpu) {
-    if (_vcpu_pause_state[vcpu_id]) {
-      _vcpu_pause_state[vcpu_id] = false;
-    } else {
-      return;
-    }
-  } else {
-    throw std::runtime_error("Unknown domctl!");
+  std::vector<VCPU_ID> pending;
+  for (const auto vcpu_id : vcpu_ids)
+    if (_vcpu_pause_state[vcpu_id] != pause)
+      pending.push_back(vcpu_id);
+
+  if (pending.empty())
+    return;
+
+  if (pending.size() == 1) {
+    const auto vcpu_id = pending.front();
+    hypercall_domctl(hypercall,
+      [vcpu_id](auto &u) {
+        auto &op = u.gdbsx_pauseunp_vcpu;
+        op.vcpu = vcpu_id;
+      });
+    _vcpu_pause_state[vcpu_id] = pause;
+    return;
   }
 
-  hypercall_domctl(hypercall,
-    [vcpu_id](auto &u) {
+  // Everything else goes out in a single multicall
+  const auto errors = get_xencall().do_domctls(_domid, hypercall, pending.size(),
+    [&pending](size_t i, auto &u) {
       auto &op = u.gdbsx_pauseunp_vcpu;
-      op.vcpu = vcpu_id;
+      op.vcpu = pending[i];
     });
+
+  int err = 0;
+  for (size_t i = 0; i < pending.size(); ++i) {
+    if (errors[i])
+      err = errors[i];
+    else
+      _vcpu_pause_state[pending[i]] = pause;
+  }
+
+  if (err)
+    throw XenException(
+        "Failed to " + std::string(pause ? "pause" : "unpause") +
+        " VCPUs of domain " + std::to_string(_domid), err);
 }
 
 void Domain::pause_unpause_vcpus_except(uint32_t hypercall, VCPU_ID vcpu_id) {
   const auto max_vcpu_id = get_dominfo().max_vcpu_id;
 
-  for (VCPU_ID id = 0; id <= max_vcpu_id; ++id) {
-    if (id == vcpu_id)
-      continue;
-    pause_unpause_vcpu(hypercall, id);
-  }
+  std::vector<VCPU_ID> vcpu_ids;
+  for (VCPU_ID id = 0; id <= max_vcpu_id; ++id)
+    if (id != vcpu_id)
+      vcpu_ids.push_back(id);
+
+  pause_unpause_vcpus(hypercall, vcpu_ids);
 }
 
 void Domain::pause_unpause_all_vcpus(uint32_t hypercall) {
   const auto max_vcpu_id = get_dominfo().max_vcpu_id;
 
+  std::vector<VCPU_ID> vcpu_ids(max_vcpu_id + 1);
   for (VCPU_ID id = 0; id <= max_vcpu_id; ++id)
-    pause_unpause_vcpu(hypercall, id);
+    vcpu_ids[id] = id;
+
+  pause_unpause_vcpus(hypercall, vcpu_ids);
 }
 
 void Domain::pause() const {
@@ -295,9 +356,13 @@ void Domain::pause() const {
   if ((err = xc_domain_pause(_xen->xenctrl.get(), _domid)))
     throw XenException(
         "Failed to pause domain " + std::to_string(_domid), -err);
+
+  _info_cache->set_paused(true);
 }
 
 void Domain::unpause() const {
+  invalidate_caches();
+
   const auto dominfo = get_dominfo();
   if (!dominfo.paused)
     return;
@@ -306,6 +371,8 @@ void Domain::unpause() const {
   if ((err = xc_domain_unpause(_xen->xenctrl.get(), _domid)))
     throw XenException(
         "Failed to unpause domain " + std::to_string(_domid), -err);
+
+  _info_cache->set_paused(false);
 }
 
 void Domain::shutdown(int reason) const {
@@ -333,8 +400,8 @@ xen_pfn_t Domain::get_max_gpfn() const {
   return max_gpfn;
 }
 
-XenCall::DomctlUnion Domain::hypercall_domctl(uint32_t command, XenCall::InitFn init, XenCall::CleanupFn cleanup) const {
-  return _xen->xenctrl.xencall.do_domctl(*this, command, std::move(init), std::move(cleanup));
+XenCall &Domain::get_xencall() const {
+  return _xen->xenctrl.xencall;
 }
 
 void Domain::set_access_required(bool required) {
@@ -346,6 +413,101 @@ XenForeignMemory &Domain::get_xenforeignmemory() const {
   return _xen->xenforeignmemory;
 }
 
+Address Domain::translate_mapped_address(Address vaddr) const {
+  const auto mfn = translate_foreign_address(vaddr, 0);
+  if (!mfn)
+    throw XenException("Failed to translate address " + std::to_string(vaddr) +
+                       " of domain " + std::to_string(_domid), EFAULT);
+  return *mfn;
+}
+
+ForeignMemoryCache::Page Domain::map_page_cached(Address mfn, int prot) const {
+  return _memory_cache->get(mfn, prot, [this, mfn, prot]() {
+    return get_xenforeignmemory().map_by_mfn<void>(*this, mfn, 0, XC_PAGE_SIZE, prot);
+  });
+}
+
+void Domain::read_memory(Address address, void *data, size_t size, MemoryBackend backend) const {
+  if (backend == MemoryBackend::Auto)
+    backend = choose_memory_backend(address, size, PROT_READ);
+
+  if (backend == MemoryBackend::GuestMemIO) {
+    guest_memio(address, data, size, false);
+  } else {
+    const auto mem = map_memory<char>(address, size, PROT_READ);
+    std::memcpy(data, mem.get(), size);
+  }
+}
+
+void Domain::write_memory(Address address, const void *data, size_t size, MemoryBackend backend) const {
+  if (backend == MemoryBackend::Auto)
+    backend = choose_memory_backend(address, size, PROT_READ | PROT_WRITE);
+
+  if (backend == MemoryBackend::GuestMemIO) {
+    guest_memio(address, const_cast<void*>(data), size, true);
+  } else {
+    const auto mem = map_memory<char>(address, size, PROT_READ | PROT_WRITE);
+    std::memcpy(mem.get(), data, size);
+  }
+}
+
+Domain::MemoryBackend Domain::choose_memory_backend(Address address, size_t size, int prot) const {
+  // Anything already mapped costs nothing more to touch again
+  if (size > GUEST_MEMIO_MAX_SIZE || is_mapped(address, size, prot))
+    return MemoryBackend::ForeignMapping;
+  return MemoryBackend::GuestMemIO;
+}
+
+bool Domain::is_mapped(Address address, size_t size, int prot) const {
+  // Only consult what is cached; finding out otherwise would cost hypercalls
+  const auto mode = _translation_cache->get_paging_mode(0);
+  if (!mode || !size)
+    return false;
+
+  const auto last_vpage = (address + size - 1) >> XC_PAGE_SHIFT;
+  for (auto vpage = address >> XC_PAGE_SHIFT; vpage <= last_vpage; ++vpage) {
+    const auto mfn = _translation_cache->peek(0, mode->root, vpage);
+    if (!mfn || !_memory_cache->contains(*mfn, prot))
+      return false;
+  }
+  return true;
+}
+
+void Domain::guest_memio(Address address, void *data, size_t size, bool write) const {
+  // The hypervisor copies through the bounce buffer, so that the caller's
+  // memory need not be locked
+  const auto buffer = (char*)get_xencall().get_bounce_buffer();
+  auto bytes = (char*)data;
+
+  while (size) {
+    const auto chunk = std::min(size, XenCall::BOUNCE_BUFFER_SIZE);
+    if (write)
+      std::memcpy(buffer, bytes, chunk);
+
+    const auto u = hypercall_domctl(XEN_DOMCTL_gdbsx_guestmemio,
+      [address, buffer, chunk, write](auto &u) {
+        auto &memio = u.gdbsx_guest_memio;
+        memio.pgd3val = 0;
+        memio.gva = address;
+        memio.uva = (uint64_aligned_t)((unsigned long)buffer);
+        memio.len = chunk;
+        memio.gwr = write;
+      });
+
+    if (u.gdbsx_guest_memio.remain)
+      throw XenException(
+          std::string("Failed to ") + (write ? "write" : "read") + " " +
+          std::to_string(chunk) + " bytes at guest address " + std::to_string(address));
+
+    if (!write)
+      std::memcpy(bytes, buffer, chunk);
+
+    address += chunk;
+    bytes += chunk;
+    size -= chunk;
+  }
+}
+
 // TODO: This doesn't seem to have any effect.
 /*
 void Domain::reboot() const {
@@ -355,37 +517,4 @@ void Domain::reboot() const {
   libxl_ctx_free(ctx);
 }
 
-void Domain::read_memory(Address address, void *data, size_t size) const {
-  hypercall_domctl(XEN_DOMCTL_gdbsx_guestmemio,
-    [address, data, size](auto u) {
-      auto& memio = u->gdbsx_guest_memio;
-      memio.pgd3val = 0;
-      memio.gva = address;
-      memio.uva = (uint64_aligned_t)((unsigned long)data);
-      memio.len = size;
-      memio.gwr = 0;
-
-      if (mlock(data, size))
-        throw XenException("mlock failed!", errno);
-    }, [data, size]() {
-      munlock(data, size);
-    });
-}
-
-void Domain::write_memory(Address address, void *data, size_t size) const {
-  hypercall_domctl(XEN_DOMCTL_gdbsx_guestmemio,
-    [address, data, size](auto u) {
-      auto& memio = u->gdbsx_guest_memio;
-      memio.pgd3val = 0;
-      memio.gva = address;
-      memio.uva = (uint64_aligned_t)((unsigned long)data);
-      memio.len = size;
-      memio.gwr = 1;
-
-      if (mlock(data, size))
-        throw XenException("mlock failed!", errno);
-    }, [data, size]() {
-      munlock(data, size);
-    });
-}
 */
@@ -19,16 +19,22 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <Registers/RegisterCodec.hpp>
 #include <Xen/DomainHVM.hpp>
 #include <Xen/BridgeHeaders/hvm_save.h>
 #include <Xen/BridgeHeaders/vm_event.h>
 #include <Xen/Xen.hpp>
 
+using xd::reg::DecodeResult;
+using xd::reg::RawField;
+using xd::reg::RegisterCodec;
 using xd::reg::RegistersX86Any;
 using xd::reg::x86_32::RegistersX86_32;
 using xd::reg::x86_64::RegistersX86_64;
+using xd::reg::x86_64::RegistersX86_64Target;
 using xd::xen::DomainHVM;
 using xd::xen::PagePermissions;
+using xd::xen::RegisterCache;
 using xd::xen::VCPU_ID;
 using xd::xen::Xen;
 
@@ -36,13 +42,149 @@ using xd::xen::Xen;
   _regs.get<_reg>() = _hvm._reg;
 #define GET_HVM2(_regs, _hvm, _reg, _hvm_reg) \
   _regs.get<_reg>() = _hvm._hvm_reg;
+#define XSTATE_YMM (1ULL << 2)
+// Xen saves XSAVE state in the standard format, where the YMM upper halves
+// immediately follow the legacy area and the XSAVE header
+#define XSAVE_YMM_OFFSET 576
+
+// The register layout below hardcodes these; fail the build, not the
+// debugging session, if the Xen headers disagree
+static_assert(sizeof(hvm_hw_cpu::fpu_regs) == 512,
+    "hvm_hw_cpu::fpu_regs is expected to be an FXSAVE area");
+static_assert(offsetof(decltype(hvm_hw_cpu_xsave::save_area), ymm) == XSAVE_YMM_OFFSET,
+    "The YMM upper halves are expected right after the XSAVE header");
+
 #define SET_HVM(_regs, _hvm, _reg) \
   _hvm._reg = _regs.get<_reg>();
 #define SET_HVM2(_regs, _hvm, _reg, _hvm_reg) \
   _hvm._hvm_reg = _regs.get<_reg>();
 
+namespace {
+  // Where each register of RegistersX86_64Target lives: in an hvm_hw_cpu
+  // (source 0), or in the YMM upper halves taken from the XSAVE record
+  // (source 1)
+  template <typename Reg_t>
+  struct HVMField;
+
+#define HVM_FIELD(_reg, _hvm_reg) \
+  template <> struct HVMField<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      offsetof(struct hvm_hw_cpu, _hvm_reg), sizeof(hvm_hw_cpu::_hvm_reg) }; \
+  }
+
+  HVM_FIELD(x86_64::rax, rax);
+  HVM_FIELD(x86_64::rbx, rbx);
+  HVM_FIELD(x86_64::rcx, rcx);
+  HVM_FIELD(x86_64::rdx, rdx);
+  HVM_FIELD(x86_64::rsp, rsp);
+  HVM_FIELD(x86_64::rbp, rbp);
+  HVM_FIELD(x86_64::rsi, rsi);
+  HVM_FIELD(x86_64::rdi, rdi);
+  HVM_FIELD(x86_64::r8, r8);
+  HVM_FIELD(x86_64::r9, r9);
+  HVM_FIELD(x86_64::r10, r10);
+  HVM_FIELD(x86_64::r11, r11);
+  HVM_FIELD(x86_64::r12, r12);
+  HVM_FIELD(x86_64::r13, r13);
+  HVM_FIELD(x86_64::r14, r14);
+  HVM_FIELD(x86_64::r15, r15);
+  HVM_FIELD(x86_64::rip, rip);
+  HVM_FIELD(x86_64::rflags, rflags);
+  HVM_FIELD(x86_64::fs, fs_sel);
+  HVM_FIELD(x86_64::gs, gs_sel);
+  HVM_FIELD(x86_64::cs, cs_sel);
+  HVM_FIELD(x86_64::ds, ds_sel);
+  HVM_FIELD(x86_64::es, es_sel);
+  HVM_FIELD(x86_64::ss, ss_sel);
+  HVM_FIELD(x86::cr0, cr0);
+  HVM_FIELD(x86::cr3, cr3);
+  HVM_FIELD(x86::cr4, cr4);
+  HVM_FIELD(x86::msr_efer, msr_efer);
+
+#define HVM_FPU_FIELD(_reg, _offset, _size) \
+  template <> struct HVMField<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      offsetof(struct hvm_hw_cpu, fpu_regs) + _offset, _size }; \
+  }
+
+#define HVM_FTAG_FIELD(_reg) \
+  template <> struct HVMField<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      offsetof(struct hvm_hw_cpu, fpu_regs), sizeof(hvm_hw_cpu::fpu_regs), 0, \
+      &xd::reg::x86::fxsave::read_ftag, &xd::reg::x86::fxsave::write_ftag }; \
+  }
+
+#define HVM_AVX_FIELD(_reg, _index) \
+  template <> struct HVMField<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      sizeof(xd::reg::x86::Vector128) * _index, sizeof(xd::reg::x86::Vector128), 1 }; \
+  }
+
+  HVM_FPU_FIELD(x86_64::st0, 32, 10);
+  HVM_FPU_FIELD(x86_64::st1, 48, 10);
+  HVM_FPU_FIELD(x86_64::st2, 64, 10);
+  HVM_FPU_FIELD(x86_64::st3, 80, 10);
+  HVM_FPU_FIELD(x86_64::st4, 96, 10);
+  HVM_FPU_FIELD(x86_64::st5, 112, 10);
+  HVM_FPU_FIELD(x86_64::st6, 128, 10);
+  HVM_FPU_FIELD(x86_64::st7, 144, 10);
+  HVM_FPU_FIELD(x86_64::fctrl, 0, 2);
+  HVM_FPU_FIELD(x86_64::fstat, 2, 2);
+  HVM_FTAG_FIELD(x86::ftag);
+  HVM_FPU_FIELD(x86::fioff, 8, 4);
+  HVM_FPU_FIELD(x86::fiseg, 12, 2);
+  HVM_FPU_FIELD(x86::fooff, 16, 4);
+  HVM_FPU_FIELD(x86::foseg, 20, 2);
+  HVM_FPU_FIELD(x86::fop, 6, 2);
+  HVM_FPU_FIELD(x86_64::xmm0, 160, 16);
+  HVM_FPU_FIELD(x86_64::xmm1, 176, 16);
+  HVM_FPU_FIELD(x86_64::xmm2, 192, 16);
+  HVM_FPU_FIELD(x86_64::xmm3, 208, 16);
+  HVM_FPU_FIELD(x86_64::xmm4, 224, 16);
+  HVM_FPU_FIELD(x86_64::xmm5, 240, 16);
+  HVM_FPU_FIELD(x86_64::xmm6, 256, 16);
+  HVM_FPU_FIELD(x86_64::xmm7, 272, 16);
+  HVM_FPU_FIELD(x86_64::xmm8, 288, 16);
+  HVM_FPU_FIELD(x86_64::xmm9, 304, 16);
+  HVM_FPU_FIELD(x86_64::xmm10, 320, 16);
+  HVM_FPU_FIELD(x86_64::xmm11, 336, 16);
+  HVM_FPU_FIELD(x86_64::xmm12, 352, 16);
+  HVM_FPU_FIELD(x86_64::xmm13, 368, 16);
+  HVM_FPU_FIELD(x86_64::xmm14, 384, 16);
+  HVM_FPU_FIELD(x86_64::xmm15, 400, 16);
+  HVM_FPU_FIELD(x86_64::mxcsr, 24, 4);
+  HVM_AVX_FIELD(x86_64::ymm0h, 0);
+  HVM_AVX_FIELD(x86_64::ymm1h, 1);
+  HVM_AVX_FIELD(x86_64::ymm2h, 2);
+  HVM_AVX_FIELD(x86_64::ymm3h, 3);
+  HVM_AVX_FIELD(x86_64::ymm4h, 4);
+  HVM_AVX_FIELD(x86_64::ymm5h, 5);
+  HVM_AVX_FIELD(x86_64::ymm6h, 6);
+  HVM_AVX_FIELD(x86_64::ymm7h, 7);
+  HVM_AVX_FIELD(x86_64::ymm8h, 8);
+  HVM_AVX_FIELD(x86_64::ymm9h, 9);
+  HVM_AVX_FIELD(x86_64::ymm10h, 10);
+  HVM_AVX_FIELD(x86_64::ymm11h, 11);
+  HVM_AVX_FIELD(x86_64::ymm12h, 12);
+  HVM_AVX_FIELD(x86_64::ymm13h, 13);
+  HVM_AVX_FIELD(x86_64::ymm14h, 14);
+  HVM_AVX_FIELD(x86_64::ymm15h, 15);
+
+#undef HVM_FIELD
+#undef HVM_FPU_FIELD
+#undef HVM_FTAG_FIELD
+#undef HVM_AVX_FIELD
+}
+
+using HVMCodec = RegisterCodec<RegistersX86_64Target>;
+
+static constexpr auto HVM_LAYOUT = HVMCodec::make_layout<HVMField>();
+
 DomainHVM::DomainHVM(DomID domid, std::shared_ptr<Xen> xen)
-  : Domain(domid, std::move(xen))
+  : Domain(domid, std::move(xen)),
+    _register_cache(std::make_shared<RegisterCache<struct hvm_hw_cpu>>()),
+    _avx_cache(std::make_shared<RegisterCache<AVXState>>()),
+    _save_header(std::make_shared<std::optional<HVM_SAVE_TYPE(HEADER)>>())
 {
 }
 
@@ -58,6 +200,77 @@ void DomainHVM::set_cpu_context(RegistersX86Any regs, VCPU_ID vcpu_id) const {
   set_cpu_context_raw(new_context, vcpu_id);
 }
 
+std::vector<RegistersX86Any> DomainHVM::get_cpu_contexts() const {
+  const auto max_vcpu_id = get_dominfo().max_vcpu_id;
+
+  for (VCPU_ID vcpu_id = 0; vcpu_id <= max_vcpu_id; ++vcpu_id) {
+    if (is_stopped(vcpu_id) && !_register_cache->contains(vcpu_id)) {
+      fetch_all_cpu_contexts_raw();
+      break;
+    }
+  }
+
+  std::vector<RegistersX86Any> contexts;
+  contexts.reserve(max_vcpu_id + 1);
+  for (VCPU_ID vcpu_id = 0; vcpu_id <= max_vcpu_id; ++vcpu_id)
+    contexts.push_back(convert_regs_from_hvm(get_cpu_context_raw(vcpu_id)));
+  return contexts;
+}
+
+std::string DomainHVM::get_cpu_context_hex(VCPU_ID vcpu_id) const {
+  // Fetching the AVX state fetches the CPU context too, so do it first
+  const auto avx = get_avx_state_raw(vcpu_id);
+  const auto context = get_cpu_context_raw(vcpu_id);
+  const void *sources[] = { &context, &avx };
+
+  std::string hex(HVMCodec::hex_size, '0');
+  HVMCodec::encode(sources, HVM_LAYOUT, hex.data());
+  return hex;
+}
+
+void DomainHVM::set_cpu_context_hex(const std::string &hex, VCPU_ID vcpu_id) const {
+  if (hex.size() != HVMCodec::hex_size)
+    throw XenException("Mismatched word size!");
+
+  // Writing the XSAVE record back isn't supported, so the YMM upper halves
+  // are decoded into a copy, and any change to them is refused
+  auto context = get_cpu_context_raw(vcpu_id);
+  const auto old_avx = get_avx_state_raw(vcpu_id);
+  auto avx = old_avx;
+  void *sources[] = { &context, &avx };
+
+  if (HVMCodec::decode(hex.data(), HVM_LAYOUT, sources) != DecodeResult::OK)
+    throw XenException("Malformed register data!");
+
+  if (avx != old_avx)
+    throw XenException("Writing the YMM upper halves of VCPU " +
+                       std::to_string(vcpu_id) + " is not supported", EOPNOTSUPP);
+
+  set_cpu_context_raw(context, vcpu_id);
+}
+
+size_t DomainHVM::save_cpu_context(VCPU_ID vcpu_id) const {
+  return _register_cache->save(vcpu_id, get_cpu_context_raw(vcpu_id));
+}
+
+bool DomainHVM::restore_cpu_context(size_t save_id, VCPU_ID vcpu_id) const {
+  auto context = _register_cache->take_saved(save_id, vcpu_id);
+  if (!context)
+    return false;
+
+  // Don't wind the guest's clock back to when the snapshot was taken
+  context->tsc = get_cpu_context_raw(vcpu_id).tsc;
+
+  set_cpu_context_raw(*context, vcpu_id);
+  return true;
+}
+
+void DomainHVM::sync_cpu_contexts() const {
+  _register_cache->write_back([this](const auto &contexts) {
+    write_cpu_contexts_raw(contexts);
+  });
+}
+
 void DomainHVM::set_singlestep(bool enable, VCPU_ID vcpu_id) const {
   uint32_t op = enable
                 ? XEN_DOMCTL_DEBUG_OP_SINGLE_STEP_ON
@@ -78,6 +291,17 @@ void DomainHVM::set_singlestep(bool enable, VCPU_ID vcpu_id) const {
   }
 }
 
+xd::xen::RegisterCacheStats DomainHVM::get_register_cache_stats() const {
+  return _register_cache->get_stats();
+}
+
+void DomainHVM::invalidate_caches() const {
+  sync_cpu_contexts();
+  Domain::invalidate_caches();
+  _register_cache->flush();
+  _avx_cache->flush();
+}
+
 xd::xen::XenEventChannel::RingPageAndPort DomainHVM::enable_monitor() const {
   uint32_t port;
   void *ring_page = xc_monitor_enable(_xen->xenctrl.get(), _domid, &port);
@@ -152,6 +376,15 @@ void DomainHVM::monitor_guest_request(bool enable, bool sync) {
 }
 
 struct hvm_hw_cpu DomainHVM::get_cpu_context_raw(VCPU_ID vcpu_id) const {
+  if (!is_stopped(vcpu_id))
+    return fetch_cpu_context_raw(vcpu_id);
+
+  return _register_cache->get(vcpu_id, [this, vcpu_id]() {
+    return fetch_cpu_context_raw(vcpu_id);
+  });
+}
+
+struct hvm_hw_cpu DomainHVM::fetch_cpu_context_raw(VCPU_ID vcpu_id) const {
   int err;
   struct hvm_hw_cpu context;
   if ((err = xc_domain_hvm_getcontext_partial(_xen->xenctrl.get(), _domid,
@@ -165,52 +398,150 @@ struct hvm_hw_cpu DomainHVM::get_cpu_context_raw(VCPU_ID vcpu_id) const {
   return context;
 }
 
-// from tools/libxc/xc_dom_x86.c
-// TODO: does this even work??
 void DomainHVM::set_cpu_context_raw(struct hvm_hw_cpu context, VCPU_ID vcpu_id) const {
-  struct {
-      struct hvm_save_descriptor header_d;
-      HVM_SAVE_TYPE(HEADER) header;
-      struct hvm_save_descriptor cpu_d;
-      HVM_SAVE_TYPE(CPU) cpu;
-      struct hvm_save_descriptor end_d;
-      HVM_SAVE_TYPE(END) end;
-  } context_update;
+  // Control registers may have changed, and with them the address space
+  _translation_cache->flush_vcpu(vcpu_id);
+
+  // A running VCPU's writes can't wait for it to resume
+  if (is_stopped(vcpu_id))
+    _register_cache->set(vcpu_id, context);
+  else
+    write_cpu_contexts_raw({{vcpu_id, context}});
+}
+
+// HEADER has no save handler of its own, so it can't be fetched with
+// getcontext_partial; it comes from the front of the full save record instead
+HVM_SAVE_TYPE(HEADER) DomainHVM::get_save_header() const {
+  // The header only describes the host and the domain, so never changes
+  if (!*_save_header)
+    fetch_all_cpu_contexts_raw();
+
+  if (!*_save_header)
+    throw XenException("Failed to get HVM save header of domain " +
+                       std::to_string(_domid), EINVAL);
+
+  return **_save_header;
+}
 
-  uint32_t size = xc_domain_hvm_getcontext(_xen->xenctrl.get(), _domid, nullptr, 0);
-  if (size == ((uint32_t)-1))
-    throw std::runtime_error("Failed to get HVM domain context (1)!");
+// The XSAVE record can't be fetched on its own, as its length varies, so this
+// fetches the whole save record. That fills the register cache too.
+DomainHVM::AVXState DomainHVM::get_avx_state_raw(VCPU_ID vcpu_id) const {
+  if (!is_stopped(vcpu_id))
+    return fetch_all_cpu_contexts_raw(vcpu_id);
 
-  std::unique_ptr<uint8_t> full_context((uint8_t*)calloc(1, size));
+  if (!_avx_cache->contains(vcpu_id))
+    fetch_all_cpu_contexts_raw();
 
-  size = xc_domain_hvm_getcontext(_xen->xenctrl.get(), _domid, full_context.get(), size);
-  if (size == ((uint32_t)-1))
-    throw std::runtime_error("Failed to get HVM domain context (2)!");
+  // No XSAVE record means the VCPU has no AVX state
+  return _avx_cache->get(vcpu_id, []() {
+    return AVXState{};
+  });
+}
+
+// The YMM upper halves are in their initial state (all zero) unless the
+// XSTATE_BV bit for them is set
+DomainHVM::AVXState DomainHVM::read_avx_state(const uint8_t *data, size_t length) {
+  AVXState avx{};
+  const auto xsave = (const struct hvm_hw_cpu_xsave*)data;
+  const auto save_area = offsetof(struct hvm_hw_cpu_xsave, save_area);
+
+  if (length >= save_area + XSAVE_YMM_OFFSET + sizeof(avx) &&
+      (xsave->save_area.xsave_hdr.xstate_bv & XSTATE_YMM))
+  {
+    memcpy(&avx, data + save_area + XSAVE_YMM_OFFSET, sizeof(avx));
+  }
+  return avx;
+}
+
+// The full save record holds every VCPU's CPU and XSAVE records, so one fetch
+// fills the register and AVX caches for all stopped VCPUs, as well as the
+// header. Contexts already cached (possibly dirty) are left alone. The AVX
+// state of avx_vcpu_id is returned whether it is cached or not.
+DomainHVM::AVXState DomainHVM::fetch_all_cpu_contexts_raw(VCPU_ID avx_vcpu_id) const {
+  const auto xenctrl = _xen->xenctrl.get();
+
+  const auto size = xc_domain_hvm_getcontext(xenctrl, _domid, nullptr, 0);
+  if (size <= 0)
+    throw XenException("Failed to get HVM context size of domain " +
+                       std::to_string(_domid), errno);
+
+  std::vector<uint8_t> record(size);
+  const auto length = xc_domain_hvm_getcontext(xenctrl, _domid, record.data(), record.size());
+  if (length <= 0)
+    throw XenException("Failed to get HVM context of domain " +
+                       std::to_string(_domid), errno);
+
+  // No XSAVE record means the VCPU has no AVX state
+  AVXState avx_state{};
+  size_t offset = 0;
+  while (offset + sizeof(struct hvm_save_descriptor) <= (size_t)length) {
+    const auto descriptor = (const struct hvm_save_descriptor*)&record[offset];
+    offset += sizeof(struct hvm_save_descriptor);
+
+    if (descriptor->typecode == HVM_SAVE_CODE(END) ||
+        offset + descriptor->length > (size_t)length)
+      break;
+
+    if (descriptor->typecode == HVM_SAVE_CODE(HEADER) &&
+        descriptor->length >= HVM_SAVE_LENGTH(HEADER))
+    {
+      HVM_SAVE_TYPE(HEADER) header;
+      memcpy(&header, &record[offset], sizeof(header));
+      *_save_header = header;
+    } else if (descriptor->typecode == HVM_SAVE_CODE(CPU) &&
+        descriptor->length >= HVM_SAVE_LENGTH(CPU))
+    {
+      struct hvm_hw_cpu context;
+      memcpy(&context, &record[offset], sizeof(context));
+      if (is_stopped(descriptor->instance))
+        _register_cache->insert(descriptor->instance, context);
+    } else if (descriptor->typecode == HVM_SAVE_CODE(CPU_XSAVE)) {
+      const auto avx = read_avx_state(&record[offset], descriptor->length);
+      if (descriptor->instance == avx_vcpu_id)
+        avx_state = avx;
+      if (is_stopped(descriptor->instance))
+        _avx_cache->insert(descriptor->instance, avx);
+    }
+
+    offset += descriptor->length;
+  }
+
+  return avx_state;
+}
 
-  memset(&context_update, 0, sizeof(context_update));
-  memcpy(&context_update, full_context.get(),
-      sizeof(struct hvm_save_descriptor) + HVM_SAVE_LENGTH(HEADER));
+// See tools/libxc/xc_dom_x86.c; a save record may carry any number of CPUs
+void DomainHVM::write_cpu_contexts_raw(const CPUContexts &contexts) const {
+  std::vector<uint8_t> record;
+  const auto append = [&record](const void *data, size_t size) {
+    const auto bytes = (const uint8_t*)data;
+    record.insert(record.end(), bytes, bytes + size);
+  };
+  const auto append_descriptor = [&append](uint16_t typecode, uint16_t instance, uint32_t length) {
+    struct hvm_save_descriptor descriptor;
+    descriptor.typecode = typecode;
+    descriptor.instance = instance;
+    descriptor.length = length;
+    append(&descriptor, sizeof(descriptor));
+  };
 
-  /*
-  context_update.header_d.typecode = HVM_SAVE_CODE(HEADER);
-  context_update.header_d.instance = vcpu_id;
-  context_update.header_d.length = HVM_SAVE_LENGTH(HEADER);
-   */
+  record.reserve(sizeof(struct hvm_save_descriptor) * (contexts.size() + 2) +
+      HVM_SAVE_LENGTH(HEADER) + contexts.size() * HVM_SAVE_LENGTH(CPU));
 
-  context_update.cpu_d.typecode = HVM_SAVE_CODE(CPU);
-  context_update.cpu_d.instance = vcpu_id;
-  context_update.cpu_d.length = HVM_SAVE_LENGTH(CPU);
+  const auto header = get_save_header();
+  append_descriptor(HVM_SAVE_CODE(HEADER), 0, HVM_SAVE_LENGTH(HEADER));
+  append(&header, sizeof(header));
 
-  context_update.cpu = context;
+  for (const auto &[vcpu_id, context] : contexts) {
+    append_descriptor(HVM_SAVE_CODE(CPU), vcpu_id, HVM_SAVE_LENGTH(CPU));
+    append(&context, sizeof(context));
+  }
 
-  context_update.end_d.typecode = HVM_SAVE_CODE(END);
-  context_update.end_d.instance = vcpu_id;
-  context_update.end_d.length = HVM_SAVE_LENGTH(END);
+  append_descriptor(HVM_SAVE_CODE(END), 0, HVM_SAVE_LENGTH(END));
 
   const int ret = xc_domain_hvm_setcontext(_xen->xenctrl.get(), _domid,
-      (uint8_t*)&context_update, sizeof(context_update));
+      record.data(), record.size());
   if (ret)
-    throw std::runtime_error("Failed to set HVM domain context!");
+    throw XenException("Failed to set HVM context of domain " + std::to_string(_domid), errno);
 }
 
 RegistersX86Any DomainHVM::convert_regs_from_hvm(const struct hvm_hw_cpu &hvm) {
@@ -237,11 +568,12 @@ RegistersX86Any DomainHVM::convert_regs_from_hvm(const struct hvm_hw_cpu &hvm) {
   GET_HVM(regs, hvm, r15);
   GET_HVM(regs, hvm, rip);
   GET_HVM(regs, hvm, rflags);
-  GET_HVM2(regs, hvm, fs, fs_base);
-  GET_HVM2(regs, hvm, gs, gs_base);
-  GET_HVM2(regs, hvm, cs, cs_base);
-  GET_HVM2(regs, hvm, ds, ds_base);
-  GET_HVM2(regs, hvm, ss, ss_base);
+  GET_HVM2(regs, hvm, fs, fs_sel);
+  GET_HVM2(regs, hvm, gs, gs_sel);
+  GET_HVM2(regs, hvm, cs, cs_sel);
+  GET_HVM2(regs, hvm, ds, ds_sel);
+  GET_HVM2(regs, hvm, es, es_sel);
+  GET_HVM2(regs, hvm, ss, ss_sel);
   GET_HVM(regs, hvm, cr0);
   GET_HVM(regs, hvm, cr3);
   GET_HVM(regs, hvm, cr4);
@@ -272,11 +604,12 @@ struct hvm_hw_cpu DomainHVM::convert_regs_to_hvm(const RegistersX86_64 &regs, hv
   SET_HVM(regs, hvm, r15);
   SET_HVM(regs, hvm, rip);
   SET_HVM(regs, hvm, rflags);
-  SET_HVM2(regs, hvm, fs, fs_base);
-  SET_HVM2(regs, hvm, gs, gs_base);
-  SET_HVM2(regs, hvm, cs, cs_base);
-  SET_HVM2(regs, hvm, ds, ds_base);
-  SET_HVM2(regs, hvm, ss, ss_base);
+  SET_HVM2(regs, hvm, fs, fs_sel);
+  SET_HVM2(regs, hvm, gs, gs_sel);
+  SET_HVM2(regs, hvm, cs, cs_sel);
+  SET_HVM2(regs, hvm, ds, ds_sel);
+  SET_HVM2(regs, hvm, es, es_sel);
+  SET_HVM2(regs, hvm, ss, ss_sel);
   SET_HVM(regs, hvm, cr0);
   SET_HVM(regs, hvm, cr3);
   SET_HVM(regs, hvm, cr4);
@@ -19,32 +19,22 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
-#ifndef XENDBG_GDBPACKETQUEUE_HPP
-#define XENDBG_GDBPACKETQUEUE_HPP
+#include <Xen/DomainInfoCache.hpp>
 
-#include <exception>
-#include <optional>
-#include <queue>
-#include <string>
+using xd::xen::DomainInfoCache;
 
-#include "GDBPacket.hpp"
-
-namespace xd::gdb {
-
-  class NoPacketException : std::exception {};
-
-  class GDBPacketQueue {
-  public:
-    void append(const std::vector<char> &data);
-    GDBPacket pop();
-
-    bool empty() const { return _packets.empty(); };
-
-  private:
-    std::queue<GDBPacket> _packets;
-    std::vector<char> _buffer;
-  };
+DomainInfoCache::DomainInfoCache()
+  : _stats{}
+{
+}
 
+void DomainInfoCache::set_paused(bool paused) {
+  if (_dominfo)
+    _dominfo->paused = paused;
 }
 
-#endif //XENDBG_GDBPACKETQUEUE_HPP
+void DomainInfoCache::refresh() {
+  _dominfo.reset();
+  _word_size.reset();
+  ++_stats.refreshes;
+}
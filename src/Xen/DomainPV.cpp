@@ -19,19 +19,33 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <Registers/RegisterCodec.hpp>
 #include <Xen/DomainPV.hpp>
 #include <Xen/Xen.hpp>
 #include <Util/overloaded.hpp>
 
+using xd::reg::DecodeResult;
+using xd::reg::RawField;
+using xd::reg::RegisterCodec;
 using xd::reg::RegistersX86Any;
 using xd::reg::x86_32::RegistersX86_32;
+using xd::reg::x86_32::RegistersX86_32Target;
 using xd::reg::x86_64::RegistersX86_64;
+using xd::reg::x86_64::RegistersX86_64Target;
 using xd::xen::DomainPV;
 using xd::xen::PagePermissions;
+using xd::xen::RegisterCache;
+using xd::xen::XenException;
 using xd::util::overloaded;
 
 #define X86_EFLAGS_TF 0x00000100
 
+// The register layouts below hardcode FXSAVE offsets into fpu_ctxt
+static_assert(sizeof(((vcpu_guest_context_any_t*)nullptr)->x64.fpu_ctxt) == 512,
+    "vcpu_guest_context_x86_64_t::fpu_ctxt is expected to be an FXSAVE area");
+static_assert(sizeof(((vcpu_guest_context_any_t*)nullptr)->x32.fpu_ctxt) == 512,
+    "vcpu_guest_context_x86_32_t::fpu_ctxt is expected to be an FXSAVE area");
+
 #define GET_PV(_regs, _pv, _reg) \
   _regs.get<_reg>() = _pv._reg;
 #define GET_PV_USER(_regs, _pv, _reg) \
@@ -41,12 +55,236 @@ using xd::util::overloaded;
 #define SET_PV_USER(_regs, _pv, _reg) \
   _pv.user_regs._reg = _regs.get<_reg>();
 
+namespace {
+  // Where each register of RegistersX86_64Target/RegistersX86_32Target lives
+  // in a vcpu_guest_context_any_t. PV contexts don't carry EFER or the YMM
+  // upper halves, so those are reported as unavailable.
+  template <typename Reg_t>
+  struct PV64Field;
+  template <typename Reg_t>
+  struct PV32Field;
+
+#define PV_FIELD(_field_of, _reg, _pv_member) \
+  template <> struct _field_of<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      offsetof(vcpu_guest_context_any_t, _pv_member), \
+      sizeof(((vcpu_guest_context_any_t*)nullptr)->_pv_member) }; \
+  }
+#define PV_FPU_FIELD(_field_of, _variant, _reg, _offset, _size) \
+  template <> struct _field_of<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      offsetof(vcpu_guest_context_any_t, _variant.fpu_ctxt) + _offset, _size }; \
+  }
+#define PV_FTAG_FIELD(_field_of, _variant, _reg) \
+  template <> struct _field_of<xd::reg::_reg> { \
+    static constexpr RawField field = { \
+      offsetof(vcpu_guest_context_any_t, _variant.fpu_ctxt), \
+      sizeof(((vcpu_guest_context_any_t*)nullptr)->_variant.fpu_ctxt), 0, \
+      &xd::reg::x86::fxsave::read_ftag, &xd::reg::x86::fxsave::write_ftag }; \
+  }
+#define PV_NO_FIELD(_field_of, _reg) \
+  template <> struct _field_of<xd::reg::_reg> { \
+    static constexpr RawField field = { 0, 0 }; \
+  }
+
+  PV_FIELD(PV64Field, x86_64::rax, x64.user_regs.rax);
+  PV_FIELD(PV64Field, x86_64::rbx, x64.user_regs.rbx);
+  PV_FIELD(PV64Field, x86_64::rcx, x64.user_regs.rcx);
+  PV_FIELD(PV64Field, x86_64::rdx, x64.user_regs.rdx);
+  PV_FIELD(PV64Field, x86_64::rsp, x64.user_regs.rsp);
+  PV_FIELD(PV64Field, x86_64::rbp, x64.user_regs.rbp);
+  PV_FIELD(PV64Field, x86_64::rsi, x64.user_regs.rsi);
+  PV_FIELD(PV64Field, x86_64::rdi, x64.user_regs.rdi);
+  PV_FIELD(PV64Field, x86_64::r8, x64.user_regs.r8);
+  PV_FIELD(PV64Field, x86_64::r9, x64.user_regs.r9);
+  PV_FIELD(PV64Field, x86_64::r10, x64.user_regs.r10);
+  PV_FIELD(PV64Field, x86_64::r11, x64.user_regs.r11);
+  PV_FIELD(PV64Field, x86_64::r12, x64.user_regs.r12);
+  PV_FIELD(PV64Field, x86_64::r13, x64.user_regs.r13);
+  PV_FIELD(PV64Field, x86_64::r14, x64.user_regs.r14);
+  PV_FIELD(PV64Field, x86_64::r15, x64.user_regs.r15);
+  PV_FIELD(PV64Field, x86_64::rip, x64.user_regs.rip);
+  PV_FIELD(PV64Field, x86_64::rflags, x64.user_regs.rflags);
+  PV_FIELD(PV64Field, x86_64::fs, x64.user_regs.fs);
+  PV_FIELD(PV64Field, x86_64::gs, x64.user_regs.gs);
+  PV_FIELD(PV64Field, x86_64::cs, x64.user_regs.cs);
+  PV_FIELD(PV64Field, x86_64::ds, x64.user_regs.ds);
+  PV_FIELD(PV64Field, x86_64::es, x64.user_regs.es);
+  PV_FIELD(PV64Field, x86_64::ss, x64.user_regs.ss);
+  PV_FIELD(PV64Field, x86::cr0, c.ctrlreg[0]);
+  PV_FIELD(PV64Field, x86::cr3, c.ctrlreg[3]);
+  PV_FIELD(PV64Field, x86::cr4, c.ctrlreg[4]);
+  PV_NO_FIELD(PV64Field, x86::msr_efer);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st0, 32, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st1, 48, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st2, 64, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st3, 80, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st4, 96, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st5, 112, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st6, 128, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::st7, 144, 10);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::fctrl, 0, 2);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::fstat, 2, 2);
+  PV_FTAG_FIELD(PV64Field, x64, x86::ftag);
+  PV_FPU_FIELD(PV64Field, x64, x86::fioff, 8, 4);
+  PV_FPU_FIELD(PV64Field, x64, x86::fiseg, 12, 2);
+  PV_FPU_FIELD(PV64Field, x64, x86::fooff, 16, 4);
+  PV_FPU_FIELD(PV64Field, x64, x86::foseg, 20, 2);
+  PV_FPU_FIELD(PV64Field, x64, x86::fop, 6, 2);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm0, 160, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm1, 176, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm2, 192, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm3, 208, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm4, 224, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm5, 240, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm6, 256, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm7, 272, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm8, 288, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm9, 304, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm10, 320, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm11, 336, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm12, 352, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm13, 368, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm14, 384, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::xmm15, 400, 16);
+  PV_FPU_FIELD(PV64Field, x64, x86_64::mxcsr, 24, 4);
+  PV_NO_FIELD(PV64Field, x86_64::ymm0h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm1h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm2h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm3h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm4h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm5h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm6h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm7h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm8h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm9h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm10h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm11h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm12h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm13h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm14h);
+  PV_NO_FIELD(PV64Field, x86_64::ymm15h);
+
+  PV_FIELD(PV32Field, x86_32::eax, x32.user_regs.eax);
+  PV_FIELD(PV32Field, x86_32::ebx, x32.user_regs.ebx);
+  PV_FIELD(PV32Field, x86_32::ecx, x32.user_regs.ecx);
+  PV_FIELD(PV32Field, x86_32::edx, x32.user_regs.edx);
+  PV_FIELD(PV32Field, x86_32::esp, x32.user_regs.esp);
+  PV_FIELD(PV32Field, x86_32::ss, x32.user_regs.ss);
+  PV_FIELD(PV32Field, x86_32::ebp, x32.user_regs.ebp);
+  PV_FIELD(PV32Field, x86_32::esi, x32.user_regs.esi);
+  PV_FIELD(PV32Field, x86_32::edi, x32.user_regs.edi);
+  PV_FIELD(PV32Field, x86_32::eip, x32.user_regs.eip);
+  PV_FIELD(PV32Field, x86_32::eflags, x32.user_regs.eflags);
+  PV_FIELD(PV32Field, x86_32::cs, x32.user_regs.cs);
+  PV_FIELD(PV32Field, x86_32::ds, x32.user_regs.ds);
+  PV_FIELD(PV32Field, x86_32::es, x32.user_regs.es);
+  PV_FIELD(PV32Field, x86_32::fs, x32.user_regs.fs);
+  PV_FIELD(PV32Field, x86_32::gs, x32.user_regs.gs);
+  PV_FIELD(PV32Field, x86::cr0, c.ctrlreg[0]);
+  PV_FIELD(PV32Field, x86::cr3, c.ctrlreg[3]);
+  PV_FIELD(PV32Field, x86::cr4, c.ctrlreg[4]);
+  PV_NO_FIELD(PV32Field, x86::msr_efer);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st0, 32, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st1, 48, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st2, 64, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st3, 80, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st4, 96, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st5, 112, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st6, 128, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::st7, 144, 10);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::fctrl, 0, 2);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::fstat, 2, 2);
+  PV_FTAG_FIELD(PV32Field, x32, x86::ftag);
+  PV_FPU_FIELD(PV32Field, x32, x86::fioff, 8, 4);
+  PV_FPU_FIELD(PV32Field, x32, x86::fiseg, 12, 2);
+  PV_FPU_FIELD(PV32Field, x32, x86::fooff, 16, 4);
+  PV_FPU_FIELD(PV32Field, x32, x86::foseg, 20, 2);
+  PV_FPU_FIELD(PV32Field, x32, x86::fop, 6, 2);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm0, 160, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm1, 176, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm2, 192, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm3, 208, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm4, 224, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm5, 240, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm6, 256, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::xmm7, 272, 16);
+  PV_FPU_FIELD(PV32Field, x32, x86_32::mxcsr, 24, 4);
+
+#undef PV_FIELD
+#undef PV_FPU_FIELD
+#undef PV_FTAG_FIELD
+#undef PV_NO_FIELD
+}
+
+using PV64Codec = RegisterCodec<RegistersX86_64Target>;
+using PV32Codec = RegisterCodec<RegistersX86_32Target>;
+static constexpr auto PV64_LAYOUT = PV64Codec::make_layout<PV64Field>();
+static constexpr auto PV32_LAYOUT = PV32Codec::make_layout<PV32Field>();
+
+template <typename Codec_t>
+static std::string encode_pv(const vcpu_guest_context_any_t &context,
+    const typename Codec_t::Layout &layout)
+{
+  const void *sources[] = { &context };
+
+  std::string hex(Codec_t::hex_size, '0');
+  Codec_t::encode(sources, layout, hex.data());
+  return hex;
+}
+
+template <typename Codec_t>
+static void decode_pv(const std::string &hex, const typename Codec_t::Layout &layout,
+    vcpu_guest_context_any_t &context)
+{
+  if (hex.size() != Codec_t::hex_size)
+    throw XenException("Mismatched word size!");
+  void *sources[] = { &context };
+  switch (Codec_t::decode(hex.data(), layout, sources)) {
+    case DecodeResult::OK:
+      break;
+    case DecodeResult::Malformed:
+      throw XenException("Malformed register data!");
+    case DecodeResult::Unavailable:
+      throw XenException("Writing registers that PV contexts don't carry "
+                         "is not supported", EOPNOTSUPP);
+  }
+}
+
 DomainPV::DomainPV(DomID domid, std::shared_ptr<Xen> xen)
-  : Domain(domid, std::move(xen))
+  : Domain(domid, std::move(xen)),
+    _register_cache(std::make_shared<RegisterCache<vcpu_guest_context_any_t>>())
 {
 }
 
+xd::xen::RegisterCacheStats DomainPV::get_register_cache_stats() const {
+  return _register_cache->get_stats();
+}
+
+void DomainPV::sync_cpu_contexts() const {
+  // No batched form of setcontext for PV, so one hypercall per VCPU
+  _register_cache->write_back([this](const auto &contexts) {
+    for (const auto &[vcpu_id, context] : contexts)
+      write_cpu_context_raw(context, vcpu_id);
+  });
+}
+
+void DomainPV::invalidate_caches() const {
+  sync_cpu_contexts();
+  Domain::invalidate_caches();
+  _register_cache->flush();
+}
+
 vcpu_guest_context_any_t DomainPV::get_cpu_context_raw(VCPU_ID vcpu_id) const {
+  if (!is_stopped(vcpu_id))
+    return fetch_cpu_context_raw(vcpu_id);
+
+  return _register_cache->get(vcpu_id, [this, vcpu_id]() {
+    return fetch_cpu_context_raw(vcpu_id);
+  });
+}
+
+vcpu_guest_context_any_t DomainPV::fetch_cpu_context_raw(VCPU_ID vcpu_id) const {
   int err;
   vcpu_guest_context_any_t context_any;
   if ((err = xc_vcpu_getcontext(_xen->xenctrl.get(), _domid, (uint16_t)vcpu_id, &context_any))) {
@@ -76,6 +314,17 @@ void DomainPV::set_cpu_context(xd::reg::RegistersX86Any regs, VCPU_ID vcpu_id) c
 }
 
 void DomainPV::set_cpu_context_raw(vcpu_guest_context_any_t context, VCPU_ID vcpu_id) const {
+  // Control registers may have changed, and with them the address space
+  _translation_cache->flush_vcpu(vcpu_id);
+
+  // A running VCPU's writes can't wait for it to resume
+  if (is_stopped(vcpu_id))
+    _register_cache->set(vcpu_id, context);
+  else
+    write_cpu_context_raw(context, vcpu_id);
+}
+
+void DomainPV::write_cpu_context_raw(vcpu_guest_context_any_t context, VCPU_ID vcpu_id) const {
   int err = xc_vcpu_setcontext(_xen->xenctrl.get(), _domid, vcpu_id, &context);
 
   if (err < 0) {
@@ -100,6 +349,51 @@ RegistersX86Any DomainPV::get_cpu_context(VCPU_ID vcpu_id) const {
   }
 }
 
+std::string DomainPV::get_cpu_context_hex(VCPU_ID vcpu_id) const {
+  const auto context_any = get_cpu_context_raw(vcpu_id);
+  const int word_size = get_word_size();
+
+  if (word_size == sizeof(uint64_t)) {
+    return encode_pv<PV64Codec>(context_any, PV64_LAYOUT);
+  } else if (word_size == sizeof(uint32_t)) {
+    return encode_pv<PV32Codec>(context_any, PV32_LAYOUT);
+  } else {
+    throw XenException(
+        "Unsupported word size " + std::to_string(word_size) + " for domain " +
+        std::to_string(_domid) + "!");
+  }
+}
+
+void DomainPV::set_cpu_context_hex(const std::string &hex, VCPU_ID vcpu_id) const {
+  auto context_any = get_cpu_context_raw(vcpu_id);
+  const int word_size = get_word_size();
+
+  if (word_size == sizeof(uint64_t)) {
+    decode_pv<PV64Codec>(hex, PV64_LAYOUT, context_any);
+  } else if (word_size == sizeof(uint32_t)) {
+    decode_pv<PV32Codec>(hex, PV32_LAYOUT, context_any);
+  } else {
+    throw XenException(
+        "Unsupported word size " + std::to_string(word_size) + " for domain " +
+        std::to_string(_domid) + "!");
+  }
+
+  set_cpu_context_raw(context_any, vcpu_id);
+}
+
+size_t DomainPV::save_cpu_context(VCPU_ID vcpu_id) const {
+  return _register_cache->save(vcpu_id, get_cpu_context_raw(vcpu_id));
+}
+
+bool DomainPV::restore_cpu_context(size_t save_id, VCPU_ID vcpu_id) const {
+  const auto context = _register_cache->take_saved(save_id, vcpu_id);
+  if (!context)
+    return false;
+
+  set_cpu_context_raw(*context, vcpu_id);
+  return true;
+}
+
 void DomainPV::set_singlestep(bool enable, VCPU_ID vcpu_id) const {
   auto context_any = get_cpu_context(vcpu_id);
   std::visit(util::overloaded {
@@ -151,6 +445,7 @@ RegistersX86_64 DomainPV::convert_regs_from_pv64(const vcpu_guest_context_any_t
   GET_PV_USER(regs, pv64, gs);
   GET_PV_USER(regs, pv64, cs);
   GET_PV_USER(regs, pv64, ds);
+  GET_PV_USER(regs, pv64, es);
   GET_PV_USER(regs, pv64, ss);
 
   regs.get<cr0>() = pv.c.ctrlreg[0];
@@ -190,6 +485,7 @@ vcpu_guest_context_any_t DomainPV::convert_regs_to_pv64(const RegistersX86_64 &r
   SET_PV_USER(regs, pv64, gs);
   SET_PV_USER(regs, pv64, cs);
   SET_PV_USER(regs, pv64, ds);
+  SET_PV_USER(regs, pv64, es);
   SET_PV_USER(regs, pv64, ss);
 
   pv.c.ctrlreg[0] = regs.get<cr0>();
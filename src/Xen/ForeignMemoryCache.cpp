@@ -0,0 +1,147 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <algorithm>
+
+#include <Xen/ForeignMemoryCache.hpp>
+
+using xd::xen::ForeignMemoryCache;
+
+ForeignMemoryCache::ForeignMemoryCache(size_t capacity)
+  : _head(NONE), _tail(NONE), _size(0), _stats{}
+{
+  _slots.reserve(capacity);
+  for (size_t i = 0; i < capacity; ++i)
+    _slots.push_back(std::make_shared<Slot>());
+
+  // Keep the table at most half full so that probe sequences stay short
+  size_t table_size = 1;
+  while (table_size < 2 * capacity)
+    table_size <<= 1;
+  _table.assign(table_size, NONE);
+}
+
+void ForeignMemoryCache::clear() {
+  for (Index i = 0; i < _slots.size(); ++i) {
+    auto &slot = *_slots[i];
+    slot.cached = false;
+    slot.prev = slot.next = NONE;
+
+    // Pages still in use stay mapped until the slot is next claimed
+    if (!is_pinned(i))
+      slot.mapping.reset();
+  }
+
+  std::fill(_table.begin(), _table.end(), NONE);
+  _head = _tail = NONE;
+  _size = 0;
+}
+
+ForeignMemoryCache::Index ForeignMemoryCache::find(Key key) const {
+  const auto mask = _table.size() - 1;
+  for (auto i = home(key); _table[i] != NONE; i = (i + 1) & mask)
+    if (_slots[_table[i]]->key == key)
+      return _table[i];
+  return NONE;
+}
+
+ForeignMemoryCache::Index ForeignMemoryCache::claim() {
+  // Prefer a slot that isn't caching anything, then the least recently
+  // used one that nobody is holding on to
+  for (Index i = 0; i < _slots.size(); ++i) {
+    if (!_slots[i]->cached && !is_pinned(i)) {
+      _slots[i]->mapping.reset();
+      return i;
+    }
+  }
+
+  for (auto i = _tail; i != NONE; i = _slots[i]->prev) {
+    if (!is_pinned(i)) {
+      remove(i);
+      _slots[i]->mapping.reset();
+      ++_stats.evictions;
+      return i;
+    }
+  }
+
+  return NONE;
+}
+
+void ForeignMemoryCache::insert(Key key, Index slot) {
+  const auto mask = _table.size() - 1;
+  auto i = home(key);
+  while (_table[i] != NONE)
+    i = (i + 1) & mask;
+  _table[i] = slot;
+
+  _slots[slot]->key = key;
+  _slots[slot]->cached = true;
+  link_front(slot);
+  ++_size;
+}
+
+void ForeignMemoryCache::remove(Index slot) {
+  const auto mask = _table.size() - 1;
+  auto hole = home(_slots[slot]->key);
+  while (_table[hole] != slot)
+    hole = (hole + 1) & mask;
+
+  // Backward-shift deletion: pull later entries of the probe sequence into
+  // the hole where doing so doesn't move them before their home bucket
+  for (auto i = (hole + 1) & mask; _table[i] != NONE; i = (i + 1) & mask) {
+    const auto h = home(_slots[_table[i]]->key);
+    if (((i - h) & mask) >= ((i - hole) & mask)) {
+      _table[hole] = _table[i];
+      hole = i;
+    }
+  }
+  _table[hole] = NONE;
+
+  unlink(slot);
+  _slots[slot]->cached = false;
+  --_size;
+}
+
+void ForeignMemoryCache::unlink(Index slot) {
+  auto &s = *_slots[slot];
+  if (s.prev != NONE)
+    _slots[s.prev]->next = s.next;
+  else
+    _head = s.next;
+
+  if (s.next != NONE)
+    _slots[s.next]->prev = s.prev;
+  else
+    _tail = s.prev;
+
+  s.prev = s.next = NONE;
+}
+
+void ForeignMemoryCache::link_front(Index slot) {
+  auto &s = *_slots[slot];
+  s.prev = NONE;
+  s.next = _head;
+  if (_head != NONE)
+    _slots[_head]->prev = slot;
+  else
+    _tail = slot;
+  _head = slot;
+}
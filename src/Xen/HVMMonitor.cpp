@@ -135,6 +135,8 @@ void HVMMonitor::read_events() {
     if (_on_event)
       _on_event(req);
 
+    // The response lets the VCPU run again
+    _domain.sync_cpu_contexts();
     put_response(rsp);
   }
 
@@ -0,0 +1,207 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+#include <Xen/Domain.hpp>
+#include <Xen/PageTableWalker.hpp>
+
+using xd::xen::Address;
+using xd::xen::PageTableWalker;
+
+#define PTE_PRESENT 0x1ull
+#define PTE_RW      0x2ull
+#define PTE_USER    0x4ull
+#define PTE_PSE     0x80ull
+#define PTE_NX      (1ull << 63)
+
+#define PTE_ADDR_MASK_32    0xfffff000ull
+#define PTE_ADDR_MASK_64    0x000ffffffffff000ull
+#define PDE_4MB_ADDR_MASK   0xffc00000ull
+
+PageTableWalker::PageTableWalker(const Domain &domain, PagingMode mode)
+  : _domain(domain), _mode(mode),
+    _address_bits(mode.levels == 5 ? 57 : mode.levels == 4 ? 48 : 32)
+{
+}
+
+std::optional<PageTableWalker::Mapping> PageTableWalker::translate(Address address) {
+  const auto linear = address & ((1ull << _address_bits) - 1);
+
+  if (!_mode.levels) {
+    const auto mfn = linear >> XC_PAGE_SHIFT;
+    return Mapping{address & XC_PAGE_MASK, XC_PAGE_SIZE, mfn,
+      PageTableEntry((mfn << XC_PAGE_SHIFT) | PTE_PRESENT | PTE_RW | PTE_USER),
+      true, true, true};
+  }
+
+  bool write = true, user = true, execute = true;
+  auto table = _mode.root;
+
+  for (auto level = _mode.levels; level > 0; --level) {
+    const auto shift = get_shift(level);
+    const auto index = (linear >> shift) & (get_num_entries(level) - 1);
+    const auto entry = read_entry(level, table, index);
+
+    if (!(entry & PTE_PRESENT))
+      return std::nullopt;
+
+    // PAE PDPTEs carry no permission bits
+    if (!(_mode.levels == 3 && level == 3)) {
+      write &= !!(entry & PTE_RW);
+      user &= !!(entry & PTE_USER);
+      execute &= !(entry & PTE_NX);
+    }
+
+    if (is_leaf(level, entry)) {
+      const auto size = 1ull << shift;
+      const auto mfn = ((_mode.levels == 2 && level == 2)
+          ? (entry & PDE_4MB_ADDR_MASK)
+          : (entry & PTE_ADDR_MASK_64 & ~(size - 1))) >> XC_PAGE_SHIFT;
+
+      return Mapping{to_canonical(linear & ~(size - 1)), size, mfn,
+        PageTableEntry(entry), write, user, execute};
+    }
+
+    table = get_next_table(entry);
+  }
+
+  return std::nullopt;
+}
+
+void PageTableWalker::walk(Address first, Address last, const OnMappingFn &on_mapping) {
+  const auto mask = (1ull << _address_bits) - 1;
+  const auto linear_first = first & mask;
+  const auto linear_last = last & mask;
+
+  if (linear_first > linear_last)
+    return;
+
+  if (!_mode.levels) {
+    const auto base = linear_first & XC_PAGE_MASK;
+    const auto mfn = base >> XC_PAGE_SHIFT;
+    on_mapping(Mapping{base, linear_last - base + 1, mfn,
+      PageTableEntry((mfn << XC_PAGE_SHIFT) | PTE_PRESENT | PTE_RW | PTE_USER),
+      true, true, true});
+    return;
+  }
+
+  walk_level(_mode.levels, _mode.root, 0, linear_first, linear_last,
+      true, true, true, on_mapping);
+}
+
+void PageTableWalker::walk_level(unsigned level, Address table, Address base,
+    Address first, Address last, bool write, bool user, bool execute,
+    const OnMappingFn &on_mapping)
+{
+  const auto shift = get_shift(level);
+  const auto span = 1ull << shift;
+  const auto first_index = (first - base) >> shift;
+  const auto last_index = std::min<Address>(
+      (last - base) >> shift, get_num_entries(level) - 1);
+
+  for (auto index = first_index; index <= last_index; ++index) {
+    const auto entry = read_entry(level, table, index);
+    if (!(entry & PTE_PRESENT))
+      continue;
+
+    auto entry_write = write, entry_user = user, entry_execute = execute;
+    if (!(_mode.levels == 3 && level == 3)) {
+      entry_write &= !!(entry & PTE_RW);
+      entry_user &= !!(entry & PTE_USER);
+      entry_execute &= !(entry & PTE_NX);
+    }
+
+    const auto entry_base = base + (index << shift);
+    if (is_leaf(level, entry)) {
+      const auto mfn = ((_mode.levels == 2 && level == 2)
+          ? (entry & PDE_4MB_ADDR_MASK)
+          : (entry & PTE_ADDR_MASK_64 & ~(span - 1))) >> XC_PAGE_SHIFT;
+
+      on_mapping(Mapping{to_canonical(entry_base), span, mfn,
+        PageTableEntry(entry), entry_write, entry_user, entry_execute});
+    } else {
+      const auto entry_last = entry_base + span - 1;
+      walk_level(level - 1, get_next_table(entry), entry_base,
+          std::max<Address>(first, entry_base), std::min<Address>(last, entry_last),
+          entry_write, entry_user, entry_execute, on_mapping);
+    }
+  }
+}
+
+const char *PageTableWalker::get_table(unsigned level, Address mfn) {
+  auto &table = _tables[level - 1];
+  if (!table.memory || table.mfn != mfn) {
+    table.memory = _domain.map_memory_by_mfn<char>(mfn, 0, XC_PAGE_SIZE, PROT_READ);
+    table.mfn = mfn;
+  }
+  return table.memory.get();
+}
+
+uint64_t PageTableWalker::read_entry(unsigned level, Address table, size_t index) {
+  const auto page = get_table(level, table >> XC_PAGE_SHIFT);
+  const auto offset = (table & ~XC_PAGE_MASK);
+
+  if (_mode.levels == 2) {
+    uint32_t entry;
+    memcpy(&entry, page + offset + index * sizeof(entry), sizeof(entry));
+    return entry;
+  }
+
+  uint64_t entry;
+  memcpy(&entry, page + offset + index * sizeof(entry), sizeof(entry));
+  return entry;
+}
+
+unsigned PageTableWalker::get_shift(unsigned level) const {
+  if (_mode.levels == 2)
+    return level == 1 ? 12 : 22;
+  return 12 + 9 * (level - 1);
+}
+
+size_t PageTableWalker::get_num_entries(unsigned level) const {
+  if (_mode.levels == 2)
+    return 1024;
+  if (_mode.levels == 3 && level == 3)
+    return 4;
+  return 512;
+}
+
+bool PageTableWalker::is_leaf(unsigned level, uint64_t entry) const {
+  if (level == 1)
+    return true;
+  if (!(entry & PTE_PSE))
+    return false;
+  return level == 2 || (level == 3 && _mode.levels >= 4);
+}
+
+Address PageTableWalker::get_next_table(uint64_t entry) const {
+  return entry & ((_mode.levels == 2) ? PTE_ADDR_MASK_32 : PTE_ADDR_MASK_64);
+}
+
+Address PageTableWalker::to_canonical(Address address) const {
+  const auto sign_bit = 1ull << (_address_bits - 1);
+  if (_address_bits > 32 && (address & sign_bit))
+    return address | ~((1ull << _address_bits) - 1);
+  return address;
+}
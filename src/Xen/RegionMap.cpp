@@ -0,0 +1,82 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <limits>
+
+#include <Xen/RegionMap.hpp>
+
+using xd::xen::Address;
+using xd::xen::RegionMap;
+
+RegionMap::RegionMap(PageTableWalker &walker)
+  : _last_address(walker.get_last_address())
+{
+  std::optional<Region> current;
+
+  walker.walk(0, std::numeric_limits<Address>::max(),
+    [&](const PageTableWalker::Mapping &mapping) {
+      if (current &&
+          current->start + current->size == mapping.address &&
+          current->write == mapping.write &&
+          current->execute == mapping.execute &&
+          current->user == mapping.user)
+      {
+        current->size += mapping.size;
+        return;
+      }
+
+      if (current)
+        _regions.emplace(current->start, *current);
+
+      current = Region{mapping.address, mapping.size,
+        true, mapping.write, mapping.execute, mapping.user};
+    });
+
+  if (current)
+    _regions.emplace(current->start, *current);
+}
+
+RegionMap::Region RegionMap::find(Address address) const {
+  // Past the end of a 32-bit address space, nothing is ever mapped
+  if (address > _last_address) {
+    const auto start = _last_address + 1;
+    return Region{start, 0 - start, false, false, false, false};
+  }
+
+  auto next = _regions.upper_bound(address);
+
+  Address gap_start = 0;
+  if (next != _regions.begin()) {
+    const auto &prev = std::prev(next)->second;
+    if (prev.contains(address))
+      return prev;
+    gap_start = prev.start + prev.size;
+  }
+
+  // A gap spanning all 2^64 addresses can't be sized, so it's cut one short
+  const auto gap_size = (next != _regions.end())
+    ? next->second.start - gap_start
+    : (_last_address - gap_start == std::numeric_limits<Address>::max())
+      ? std::numeric_limits<Address>::max()
+      : _last_address - gap_start + 1;
+
+  return Region{gap_start, gap_size, false, false, false, false};
+}
@@ -0,0 +1,114 @@
+//
+// Copyright (C) 2018-2019 NCC Group
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <Xen/TranslationCache.hpp>
+
+using xd::xen::Address;
+using xd::xen::PagingMode;
+using xd::xen::RegionMap;
+using xd::xen::TranslationCache;
+
+TranslationCache::TranslationCache()
+  : _stats{}
+{
+}
+
+std::optional<PagingMode> TranslationCache::get_paging_mode(VCPU_ID vcpu_id) const {
+  if (vcpu_id >= _vcpus.size())
+    return std::nullopt;
+  return _vcpus[vcpu_id].paging_mode;
+}
+
+void TranslationCache::set_paging_mode(VCPU_ID vcpu_id, PagingMode mode) {
+  get_vcpu(vcpu_id).paging_mode = mode;
+}
+
+std::shared_ptr<const RegionMap> TranslationCache::get_region_map(VCPU_ID vcpu_id) const {
+  if (vcpu_id >= _vcpus.size())
+    return nullptr;
+  return _vcpus[vcpu_id].region_map;
+}
+
+void TranslationCache::set_region_map(VCPU_ID vcpu_id, std::shared_ptr<const RegionMap> region_map) {
+  get_vcpu(vcpu_id).region_map = std::move(region_map);
+}
+
+std::optional<Address> TranslationCache::lookup(VCPU_ID vcpu_id, Address root, Address vpage) {
+  const auto mfn = peek(vcpu_id, root, vpage);
+  if (mfn)
+    ++_stats.hits;
+  else
+    ++_stats.misses;
+  return mfn;
+}
+
+std::optional<Address> TranslationCache::peek(VCPU_ID vcpu_id, Address root, Address vpage) const {
+  if (vcpu_id < _vcpus.size()) {
+    const auto &translations = _vcpus[vcpu_id].translations;
+    const auto found = translations.find(Key{root, vpage});
+    if (found != translations.end())
+      return found->second;
+  }
+  return std::nullopt;
+}
+
+void TranslationCache::insert(VCPU_ID vcpu_id, Address root, Address vpage, Address mfn) {
+  auto &translations = get_vcpu(vcpu_id).translations;
+
+  // Crude, but a full table means the guest address space is being swept,
+  // in which case there is little locality to preserve anyway
+  if (translations.size() >= MAX_ENTRIES_PER_VCPU)
+    translations.clear();
+
+  translations[Key{root, vpage}] = mfn;
+}
+
+void TranslationCache::flush() {
+  for (auto &vcpu : _vcpus) {
+    vcpu.paging_mode = std::nullopt;
+    vcpu.region_map = nullptr;
+    vcpu.translations.clear();
+  }
+  ++_stats.flushes;
+}
+
+void TranslationCache::flush_vcpu(VCPU_ID vcpu_id) {
+  if (vcpu_id >= _vcpus.size())
+    return;
+
+  auto &vcpu = _vcpus[vcpu_id];
+  vcpu.paging_mode = std::nullopt;
+  vcpu.region_map = nullptr;
+  vcpu.translations.clear();
+}
+
+size_t TranslationCache::get_size() const {
+  size_t size = 0;
+  for (const auto &vcpu : _vcpus)
+    size += vcpu.translations.size();
+  return size;
+}
+
+TranslationCache::VCPUEntries &TranslationCache::get_vcpu(VCPU_ID vcpu_id) {
+  if (vcpu_id >= _vcpus.size())
+    _vcpus.resize(vcpu_id + 1);
+  return _vcpus[vcpu_id];
+}
@@ -86,7 +86,7 @@ std::vector<DomainAny> Xen::get_domains() {
      for dead domains that don't actually exist anymore. These will have the
      same name but a lower domid, and can be safely ignored.
    */
-  for (const auto domid_str : domid_strs) {
+  for (const auto &domid_str : domid_strs) {
     const auto domid = std::stoul(domid_str);
     try {
       auto domain = init_domain(domid);
@@ -25,48 +25,62 @@
 
 #include <Xen/BridgeHeaders/xenctrl.h>
 
-#include <Xen/Domain.hpp>
 #include <Xen/XenCall.hpp>
 
+using xd::xen::DomID;
 using xd::xen::XenCall;
 using xd::xen::XenException;
 
 
 XenCall::XenCall(std::shared_ptr<xc_interface> xenctrl)
   : _xenctrl(std::move(xenctrl)),
-    _xencall(xencall_open(nullptr, 0), &xencall_close)
+    _xencall(xencall_open(nullptr, 0), &xencall_close),
+    _batch_buffer_size(0)
 {
   if (!_xencall)
     throw XenException("Failed to open xencall interface!", errno);
-}
-
-XenCall::DomctlUnion XenCall::do_domctl(const Domain &domain,
-                                        uint32_t command, InitFn init, CleanupFn cleanup) const
-{
-  DECLARE_HYPERCALL_BUFFER(xen_domctl, domctl);
 
-  domctl = (xen_domctl*)(xc_hypercall_buffer_alloc(_xenctrl.get(), domctl, sizeof(*domctl)));
-  if (!domctl)
-    throw std::runtime_error("failed to alloc hypercall buffer");
+  _bounce_buffer = alloc_buffer(BOUNCE_BUFFER_SIZE);
+  _domctl_buffer = alloc_buffer(sizeof(xen_domctl));
+}
 
-  domctl->domain = domain.get_domid();
-  domctl->interface_version = XEN_DOMCTL_INTERFACE_VERSION;
-  domctl->cmd = command;
+xen_domctl &XenCall::prepare_domctl(void *buffer, DomID domid, uint32_t command) {
+  auto &domctl = *(xen_domctl*)buffer;
+  memset(&domctl, 0, sizeof(domctl));
+  domctl.domain = domid;
+  domctl.interface_version = XEN_DOMCTL_INTERFACE_VERSION;
+  domctl.cmd = command;
+  return domctl;
+}
 
-  memset(&domctl->u, 0, sizeof(domctl->u));
-  if (init)
-    init(domctl->u);
+int XenCall::submit_domctl() const {
+  return xencall1(_xencall.get(), __HYPERVISOR_domctl,
+      (uint64_t)(unsigned long)_domctl_buffer.get());
+}
 
-  const auto err = xencall1(_xencall.get(), __HYPERVISOR_domctl, HYPERCALL_BUFFER_AS_ARG(domctl));
-  auto u = domctl->u;
+void XenCall::submit_multicall(multicall_entry_t *entries, size_t count) const {
+  const auto err = xencall2(_xencall.get(), __HYPERVISOR_multicall,
+      (uint64_t)(unsigned long)entries, count);
+  if (err)
+    throw XenException("Multicall failed", -err);
+}
 
-  xc_hypercall_buffer_free(_xenctrl.get(), domctl);
+XenCall::Buffer XenCall::alloc_buffer(size_t size) const {
+  const auto xencall = _xencall.get();
+  auto buffer = Buffer(xencall_alloc_buffer(xencall, size),
+      [xencall](void *p) { xencall_free_buffer(xencall, p); });
 
-  if (cleanup)
-    cleanup();
+  if (!buffer)
+    throw XenException("Failed to allocate hypercall buffer!", errno);
 
-  if (err)
-    throw XenException("Hypercall failed", -err);
+  return buffer;
+}
 
-  return u;
+void *XenCall::get_batch_buffer(size_t size) const {
+  // Grow-only, so that repeated sweeps over the same VCPUs reuse it
+  if (size > _batch_buffer_size) {
+    _batch_buffer = alloc_buffer(size);
+    _batch_buffer_size = size;
+  }
+  return _batch_buffer.get();
 }
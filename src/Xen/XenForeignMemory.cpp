@@ -21,6 +21,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 #include <Xen/Domain.hpp>
 #include <Xen/XenForeignMemory.hpp>
@@ -37,29 +38,34 @@ XenForeignMemory::XenForeignMemory()
     throw XenException("Failed to open Xen foreign memory handle!", errno);
 }
 
-void *XenForeignMemory::map_by_mfn_raw(const Domain &domain, Address base_mfn, Address offset, size_t size, int prot) const {
-  size_t num_pages = (size + XC_PAGE_SIZE - 1) >> XC_PAGE_SHIFT;
+// Scratch tables are reused across calls and only ever grow, so steady-state
+// mapping does not allocate
+static thread_local std::vector<xen_pfn_t> pfn_table;
+static thread_local std::vector<int> error_table;
 
-  auto pages = (xen_pfn_t*)malloc(num_pages * sizeof(xen_pfn_t));
-  auto errors = (int*)malloc(num_pages * sizeof(int));
+xen_pfn_t *XenForeignMemory::get_pfn_table(size_t num_pages) {
+  if (pfn_table.size() < num_pages)
+    pfn_table.resize(num_pages);
+  return pfn_table.data();
+}
 
-  if (!pages)
-    throw XenException("Failed to allocate PFN table: ", errno);
-  if (!errors)
-    throw XenException("Failed to allocate error table: ", errno);
+void *XenForeignMemory::map_pfns_raw(const Domain &domain, const xen_pfn_t *pages, size_t num_pages, int prot) const {
+  if (error_table.size() < num_pages)
+    error_table.resize(num_pages);
+  const auto errors = error_table.data();
 
-  for (size_t i = 0; i < num_pages; ++i)
-    pages[i] = base_mfn + i;
+  void *mem_page_base =
+      xenforeignmemory_map(_xen_foreign_memory.get(), domain.get_domid(),
+                           prot, num_pages, pages, errors);
 
-  char *mem_page_base =
-      (char*)xenforeignmemory_map(_xen_foreign_memory.get(),
-                                  domain.get_domid(), prot, num_pages, pages, errors);
+  if (!mem_page_base)
+    throw XenException("Failed to map foreign memory", errno);
 
   for (size_t i = 0; i < num_pages; ++i)
-    if (errors[i])
-      throw XenException("Failed to map page " +
-                         std::to_string(i+1) + " of " +
-                         std::to_string(num_pages), -errors[i]);
+    if (errors[i]) {
+      xenforeignmemory_unmap(_xen_foreign_memory.get(), mem_page_base, num_pages);
+      throw XenException("Failed to map foreign page", -errors[i]);
+    }
 
-  return (void*)(mem_page_base + offset);
+  return mem_page_base;
 }